@@ -81,6 +81,22 @@
 #define configUSE_MUTEXES                   1
 #define configUSE_RECURSIVE_MUTEXES         1
 #define configCHECK_FOR_STACK_OVERFLOW      2
+#define configTASK_NOTIFICATION_ARRAY_ENTRIES 2
+
+/* Run time stats are counted by a free running GPTM, see stats.c. */
+#define configGENERATE_RUN_TIME_STATS       1
+extern void stats_timer_init(void);
+extern uint32_t stats_timer_value(void);
+#define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS() stats_timer_init()
+#define portGET_RUN_TIME_COUNTER_VALUE()    stats_timer_value()
+
+/* Stop the tick while every task is blocked, the port's SysTick implementation
+is used.  stats.c counts the sleeps and the time spent in them. */
+#define configUSE_TICKLESS_IDLE             1
+extern void stats_sleep_enter(void);
+extern void stats_sleep_exit(void);
+#define configPRE_SLEEP_PROCESSING( x )     stats_sleep_enter()
+#define configPOST_SLEEP_PROCESSING( x )    stats_sleep_exit()
 
 //#define configMAX_PRIORITIES                ( ( unsigned portBASE_TYPE ) 16 )
 #define configMAX_PRIORITIES ( 16 )
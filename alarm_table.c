@@ -0,0 +1,225 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "tz_rules.h"
+#include "alarm_table.h"
+
+#define SECONDS_PER_DAY 86400
+#define SECONDS_PER_HOUR 3600
+#define SECONDS_PER_MINUTE 60
+
+// 1970-01-01 was a thursday
+#define EPOCH_WEEKDAY 4
+
+typedef struct alarm_entry_t{
+    uint32_t next_fire;
+    uint8_t hour;
+    uint8_t minute;
+    uint8_t weekdays;
+    bool in_use;
+    bool armed;
+}alarm_entry_t;
+
+// the alarms are kept in a binary min-heap of slot ids keyed by next_fire,
+// so the next due alarm is always heap[0] and every change costs O(log n)
+static alarm_entry_t l_alarms[ALARM_TABLE_SIZE];
+static uint8_t l_heap[ALARM_TABLE_SIZE];
+static uint8_t l_heap_pos[ALARM_TABLE_SIZE];
+static uint8_t l_heap_size;
+
+static tz_cache_t l_tz_cache;
+
+// first time after now at which the local clock reads hour:minute on one of the weekdays
+static uint32_t alarm_next_fire(const alarm_entry_t *alarm, uint32_t now){
+
+    uint32_t local_now = tz_to_local(&l_tz_cache, now, NULL);
+    uint32_t day = local_now / SECONDS_PER_DAY;
+    uint32_t offset = alarm->hour * SECONDS_PER_HOUR + alarm->minute * SECONDS_PER_MINUTE;
+
+    // a recurring alarm is due within a week, today's time may already have passed
+    // the local time is converted back with the offset in effect at the fire time, so alarms follow dst
+    uint8_t i;
+    for(i = 0; i != 8; ++i){
+        uint32_t local_fire = (day + i) * SECONDS_PER_DAY + offset;
+        if(local_fire > local_now &&
+           (alarm->weekdays == ALARM_ONCE || (alarm->weekdays & (1 << ((day + i + EPOCH_WEEKDAY) % 7))))){
+            uint32_t fire = tz_to_utc(&l_tz_cache, local_fire);
+            if(fire > now){
+                return fire;
+            }
+        }
+    }
+
+    return UINT32_MAX;
+}
+
+static void heap_swap(uint8_t a, uint8_t b){
+    uint8_t id = l_heap[a];
+    l_heap[a] = l_heap[b];
+    l_heap[b] = id;
+    l_heap_pos[l_heap[a]] = a;
+    l_heap_pos[l_heap[b]] = b;
+}
+
+static void heap_sift_up(uint8_t pos){
+    while(pos != 0){
+        uint8_t parent = (pos - 1) / 2;
+        if(l_alarms[l_heap[parent]].next_fire <= l_alarms[l_heap[pos]].next_fire){
+            break;
+        }
+        heap_swap(pos, parent);
+        pos = parent;
+    }
+}
+
+static void heap_sift_down(uint8_t pos){
+    while(1){
+        uint8_t smallest = pos;
+        uint8_t child = 2 * pos + 1;
+        if(child < l_heap_size && l_alarms[l_heap[child]].next_fire < l_alarms[l_heap[smallest]].next_fire){
+            smallest = child;
+        }
+        ++child;
+        if(child < l_heap_size && l_alarms[l_heap[child]].next_fire < l_alarms[l_heap[smallest]].next_fire){
+            smallest = child;
+        }
+        if(smallest == pos){
+            break;
+        }
+        heap_swap(pos, smallest);
+        pos = smallest;
+    }
+}
+
+// restores the heap after the key of the alarm at pos changed in either direction
+static void heap_fix(uint8_t pos){
+    uint8_t id = l_heap[pos];
+    heap_sift_up(pos);
+    heap_sift_down(l_heap_pos[id]);
+}
+
+static bool alarm_valid(uint8_t id){
+    return id < ALARM_TABLE_SIZE && l_alarms[id].in_use;
+}
+
+void alarm_table_init(void){
+    uint8_t id;
+    for(id = 0; id != ALARM_TABLE_SIZE; ++id){
+        l_alarms[id].in_use = false;
+    }
+    l_heap_size = 0;
+    tz_cache_init(&l_tz_cache);
+}
+
+// returns the id of the new alarm, or ALARM_TABLE_INVALID if the table is full
+uint8_t alarm_table_add(uint8_t hour, uint8_t minute, uint8_t weekdays, uint32_t now){
+
+    uint8_t id;
+    for(id = 0; id != ALARM_TABLE_SIZE; ++id){
+        if(!l_alarms[id].in_use){
+            break;
+        }
+    }
+    if(id == ALARM_TABLE_SIZE){
+        return ALARM_TABLE_INVALID;
+    }
+
+    alarm_entry_t *alarm = &l_alarms[id];
+    alarm->hour = hour;
+    alarm->minute = minute;
+    alarm->weekdays = weekdays & ALARM_EVERY_DAY;
+    alarm->in_use = true;
+    alarm->armed = true;
+    alarm->next_fire = alarm_next_fire(alarm, now);
+
+    l_heap[l_heap_size] = id;
+    l_heap_pos[id] = l_heap_size;
+    ++l_heap_size;
+    heap_sift_up(l_heap_pos[id]);
+
+    return id;
+}
+
+void alarm_table_edit(uint8_t id, uint8_t hour, uint8_t minute, uint8_t weekdays, uint32_t now){
+    if(!alarm_valid(id)){
+        return;
+    }
+
+    alarm_entry_t *alarm = &l_alarms[id];
+    alarm->hour = hour;
+    alarm->minute = minute;
+    alarm->weekdays = weekdays & ALARM_EVERY_DAY;
+    alarm->armed = true;
+    alarm->next_fire = alarm_next_fire(alarm, now);
+
+    heap_fix(l_heap_pos[id]);
+}
+
+void alarm_table_remove(uint8_t id){
+    if(!alarm_valid(id)){
+        return;
+    }
+
+    uint8_t pos = l_heap_pos[id];
+    --l_heap_size;
+    if(pos != l_heap_size){
+        heap_swap(pos, l_heap_size);
+        heap_fix(pos);
+    }
+
+    l_alarms[id].in_use = false;
+}
+
+// moves the next fire time of an alarm, e.g. to fire again after a snooze
+// this also rearms a one-shot alarm that already fired
+void alarm_table_snooze(uint8_t id, uint32_t fire){
+    if(!alarm_valid(id)){
+        return;
+    }
+
+    l_alarms[id].armed = true;
+    l_alarms[id].next_fire = fire;
+    heap_fix(l_heap_pos[id]);
+}
+
+// a recurring alarm moves on to its next day, a one-shot alarm stays in the table
+// disarmed so that it can still be snoozed until its owner removes it
+void alarm_table_fired(uint8_t id, uint32_t now){
+    if(!alarm_valid(id)){
+        return;
+    }
+
+    if(l_alarms[id].weekdays == ALARM_ONCE){
+        l_alarms[id].armed = false;
+        l_alarms[id].next_fire = UINT32_MAX;
+    }
+    else{
+        l_alarms[id].next_fire = alarm_next_fire(&l_alarms[id], now);
+    }
+    heap_fix(l_heap_pos[id]);
+}
+
+// recomputes every alarm after the clock was stepped, rebuilding the heap in O(n)
+void alarm_table_rebase(uint32_t now){
+    uint8_t pos;
+    for(pos = 0; pos != l_heap_size; ++pos){
+        alarm_entry_t *alarm = &l_alarms[l_heap[pos]];
+        if(alarm->armed){
+            alarm->next_fire = alarm_next_fire(alarm, now);
+        }
+    }
+    for(pos = l_heap_size / 2; pos != 0; --pos){
+        heap_sift_down(pos - 1);
+    }
+}
+
+// the alarm that is due first, false if no alarm is armed
+bool alarm_table_next(uint8_t *id, uint32_t *fire){
+    if(l_heap_size == 0 || !l_alarms[l_heap[0]].armed){
+        return false;
+    }
+    *id = l_heap[0];
+    *fire = l_alarms[l_heap[0]].next_fire;
+    return true;
+}
@@ -0,0 +1,31 @@
+#ifndef ALARM_TABLE_H
+#define ALARM_TABLE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define ALARM_TABLE_SIZE 32
+#define ALARM_TABLE_INVALID 0xff
+
+// weekday recurrence mask, an alarm without any weekday fires once and then stays in the table disarmed
+#define ALARM_ONCE 0x00
+#define ALARM_SUNDAY 0x01
+#define ALARM_MONDAY 0x02
+#define ALARM_TUESDAY 0x04
+#define ALARM_WEDNESDAY 0x08
+#define ALARM_THURSDAY 0x10
+#define ALARM_FRIDAY 0x20
+#define ALARM_SATURDAY 0x40
+#define ALARM_EVERY_DAY 0x7f
+
+// all times are UTC unix seconds, the alarm hour and minute are local time
+void alarm_table_init(void);
+uint8_t alarm_table_add(uint8_t hour, uint8_t minute, uint8_t weekdays, uint32_t now);
+void alarm_table_edit(uint8_t id, uint8_t hour, uint8_t minute, uint8_t weekdays, uint32_t now);
+void alarm_table_remove(uint8_t id);
+void alarm_table_snooze(uint8_t id, uint32_t fire);
+void alarm_table_fired(uint8_t id, uint32_t now);
+void alarm_table_rebase(uint32_t now);
+bool alarm_table_next(uint8_t *id, uint32_t *fire);
+
+#endif
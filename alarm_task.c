@@ -3,6 +3,7 @@
 
 #include "FreeRTOS.h"
 #include "task.h"
+#include "semphr.h"
 
 #include "inc/hw_gpio.h"
 #include "inc/hw_memmap.h"
@@ -10,32 +11,171 @@
 #include "inc/hw_types.h"
 
 #include "driverlib/gpio.h"
+#include "driverlib/hibernate.h"
 #include "driverlib/pwm.h"
 #include "driverlib/interrupt.h"
 #include "driverlib/sysctl.h"
 
+#include "alarm_table.h"
+#include "latency.h"
+#include "rtc_time.h"
 #include "time_struct.h"
 #include "priorities.h"
+#include "button_pins.h"
 
-#define ALARM_TASK_SIZE_WORDS 50
+// the deepest path, alarm_advance down to tz_cache_fill, takes about 104 words of frames plus 17 words of
+// saved context, so this leaves a quarter spare; the stats snapshot reports what is left on target
+#define ALARM_TASK_SIZE_WORDS 160
 
 #define ALARM_INTERVAL_MILLISECONDS 500
+#define SECONDS_PER_MINUTE 60
+#define ALARM_SNOOZE_SECONDS (9 * SECONDS_PER_MINUTE)
 #define PWM_FREQ 1000
 
+extern volatile time_t user_time;
+
 TaskHandle_t alarm_task_handle;
 
 volatile bool alarm_ringing;
 
+// table entry of the alarm set through the buttons, ALARM_TABLE_INVALID while none is set
+static uint8_t l_user_alarm;
+// table entry of the alarm that fired last, which a snooze moves, ALARM_TABLE_INVALID once it was removed
+static uint8_t l_fired_alarm;
+
+// guards the alarm table and l_user_alarm, which lcd_task, time_task and alarm_task all change
+// no interrupt touches the table, so it is locked without masking interrupts
+static SemaphoreHandle_t l_alarm_mutex;
+
+// ISR for the RTC match, fires at the exact second the next alarm in the table is due
+// while alarm_ringing is set the button ISR ignores every button except SET_ALARM,
+// because that is the only way to exit the alarm task
+void HIBERNATE_handler(void){
+
+    uint32_t int_status = HibernateIntStatus(true);
+    HibernateIntClear(int_status);
+
+    if(int_status & HIBERNATE_INT_RTC_MATCH_0){
+        BaseType_t higher_priority_task_woken = pdFALSE;
+
+        HibernateIntDisable(HIBERNATE_INT_RTC_MATCH_0);
+        alarm_ringing = true;
+
+        vTaskNotifyGiveFromISR(alarm_task_handle, &higher_priority_task_woken);
+        portYIELD_FROM_ISR(higher_priority_task_woken);
+    }
+}
+
+// programs the RTC match for the alarm at the top of the table, so only one match is ever armed
+// must be called with l_alarm_mutex held
+// only the register writes mask interrupts, because the match ISR writes hibernate registers too
+static void alarm_program(uint32_t now){
+
+    uint8_t id;
+    uint32_t fire;
+    bool armed = rtc_time_valid() && alarm_table_next(&id, &fire);
+
+    taskENTER_CRITICAL();
+
+    HibernateIntDisable(HIBERNATE_INT_RTC_MATCH_0);
+    if(armed){
+        // the match only triggers on equality, so an alarm that is already due fires on the next second
+        HibernateRTCMatchSet(0, (fire > now)? fire: now + 1);
+        HibernateIntClear(HIBERNATE_INT_RTC_MATCH_0);
+        HibernateIntEnable(HIBERNATE_INT_RTC_MATCH_0);
+    }
+
+    taskEXIT_CRITICAL();
+}
+
+static uint32_t alarm_now(void){
+    uint32_t seconds;
+    uint32_t subseconds;
+    rtc_time_get(&seconds, &subseconds);
+    return seconds;
+}
+
+// adds or removes the alarm set through the buttons
+// the alarm fires at the start of its minute, the minute we are in already counts as passed
+void alarm_user_set(bool set){
+
+    xSemaphoreTake(l_alarm_mutex, portMAX_DELAY);
+
+    uint32_t now = alarm_now();
+    if(set && l_user_alarm == ALARM_TABLE_INVALID){
+        l_user_alarm = alarm_table_add(user_time.hour, user_time.minute, ALARM_ONCE, now);
+    }
+    else if(!set && l_user_alarm != ALARM_TABLE_INVALID){
+        alarm_table_remove(l_user_alarm);
+        if(l_fired_alarm == l_user_alarm){
+            l_fired_alarm = ALARM_TABLE_INVALID;
+        }
+        l_user_alarm = ALARM_TABLE_INVALID;
+    }
+    alarm_program(now);
+
+    xSemaphoreGive(l_alarm_mutex);
+}
+
+// lets the alarm that fired last go off again ALARM_SNOOZE_SECONDS from now
+void alarm_user_snooze(void){
+
+    xSemaphoreTake(l_alarm_mutex, portMAX_DELAY);
+
+    uint32_t now = alarm_now();
+    alarm_table_snooze(l_fired_alarm, now + ALARM_SNOOZE_SECONDS);
+    alarm_program(now);
+
+    xSemaphoreGive(l_alarm_mutex);
+}
+
+// recomputes every alarm, must be called whenever the RTC may have been stepped
+void alarm_rebase(void){
+
+    xSemaphoreTake(l_alarm_mutex, portMAX_DELAY);
+
+    uint32_t now = alarm_now();
+    alarm_table_rebase(now);
+    alarm_program(now);
+
+    xSemaphoreGive(l_alarm_mutex);
+}
+
+// moves every alarm that is due on to its next fire time and arms the match for the one after
+static void alarm_advance(void){
+
+    xSemaphoreTake(l_alarm_mutex, portMAX_DELAY);
+
+    uint32_t now = alarm_now();
+    uint8_t id;
+    uint32_t fire;
+    while(alarm_table_next(&id, &fire) && fire <= now){
+        alarm_table_fired(id, now);
+        l_fired_alarm = id;
+    }
+    alarm_program(now);
+
+    xSemaphoreGive(l_alarm_mutex);
+}
+
 // sends PWM signal to piezo buzzer for alarm
-// can only be exited using a GPIO interrupt with the ALARM_SET pin to turn off the alarm
+// woken by the RTC match ISR, can only be exited using a GPIO interrupt with the ALARM_SET pin to turn off the alarm,
+// or with one of the time buttons to snooze it
 void alarm_task(void *args){
 
     while(1){
+        bool woken = false;
         if(!alarm_ringing){
-            vTaskSuspend(NULL);
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            alarm_advance();
+            woken = true;
         }
 
         PWMOutputState(PWM0_BASE, PWM_OUT_5_BIT, true);
+        // alarms are due at the start of their minute, so this is how late the buzzer came on
+        if(woken){
+            latency_record(&g_latency_alarm, latency_since_minute());
+        }
         vTaskDelay(ALARM_INTERVAL_MILLISECONDS / portTICK_PERIOD_MS);
 
         PWMOutputState(PWM0_BASE, PWM_OUT_5_BIT, false);
@@ -55,8 +195,16 @@ void inline pwm_init(void){
 // create the alarm task
 void inline alarm_task_init(void){
     alarm_ringing = false;
+    l_user_alarm = ALARM_TABLE_INVALID;
+    l_fired_alarm = ALARM_TABLE_INVALID;
+    l_alarm_mutex = xSemaphoreCreateMutex();
+    alarm_table_init();
+    latency_init(&g_latency_alarm);
 
     pwm_init();
 
+    HibernateIntRegister(HIBERNATE_handler);
+    IntPrioritySet(INT_HIBERNATE_TM4C129, HIBERNATE_INT_PRIORITY);
+
     xTaskCreate(alarm_task, "alarm_task", ALARM_TASK_SIZE_WORDS, NULL, PRIORITY_ALARM_TASK, &alarm_task_handle);
 }
@@ -66,6 +66,7 @@ PinoutSet(void)
     //
     // Enable appropriate peripherals.
     //
+    MAP_SysCtlPeripheralEnable(SYSCTL_PERIPH_GPIOA);
     MAP_SysCtlPeripheralEnable(SYSCTL_PERIPH_GPIOB);
     MAP_SysCtlPeripheralEnable(SYSCTL_PERIPH_GPIOF);
     MAP_SysCtlPeripheralEnable(SYSCTL_PERIPH_GPIOG);
@@ -75,6 +76,13 @@ PinoutSet(void)
 
     MAP_SysCtlPeripheralEnable(SYSCTL_PERIPH_PWM0);
 
+    MAP_SysCtlPeripheralEnable(SYSCTL_PERIPH_HIBERNATE);
+
+    MAP_SysCtlPeripheralEnable(SYSCTL_PERIPH_TIMER0);
+    MAP_SysCtlPeripheralEnable(SYSCTL_PERIPH_TIMER1);
+
+    MAP_SysCtlPeripheralEnable(SYSCTL_PERIPH_UART0);
+
     //
     // PF0/PF4 are used for Ethernet LEDs.
     //
@@ -99,4 +107,10 @@ PinoutSet(void)
 
     MAP_GPIOPinTypePWM(GPIO_PORTG_BASE, GPIO_PIN_1);
 
+    // PA0 and PA1 are used as UART0 for the stats snapshots, this is the virtual COM port of the debugger
+    MAP_GPIOPinConfigure(GPIO_PA0_U0RX);
+    MAP_GPIOPinConfigure(GPIO_PA1_U0TX);
+
+    MAP_GPIOPinTypeUART(GPIO_PORTA_BASE, GPIO_PIN_0 | GPIO_PIN_1);
+
 }
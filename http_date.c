@@ -0,0 +1,138 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "http_date.h"
+
+#define SECONDS_PER_DAY 86400
+#define SECONDS_PER_HOUR 3600
+#define SECONDS_PER_MINUTE 60
+
+typedef enum http_date_state_t{
+    HTTP_DATE_NAME,
+    HTTP_DATE_SPACE,
+    HTTP_DATE_VALUE,
+    HTTP_DATE_SKIP_LINE
+}http_date_state_t;
+
+static const char date_name[] = "date:";
+static const char months[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
+static const uint8_t month_days[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+
+// days since 1970-01-01 for a date in the proleptic Gregorian calendar
+uint32_t http_date_days_from_civil(uint32_t year, uint32_t month, uint32_t day){
+    year -= (month <= 2);
+    uint32_t era = year / 400;
+    uint32_t year_of_era = year - era * 400;
+    uint32_t day_of_year = (153 * (month > 2? month - 3: month + 9) + 2) / 5 + day - 1;
+    uint32_t day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+    return era * 146097 + day_of_era - 719468;
+}
+
+static bool two_digits(const char *str, uint32_t max, uint32_t *value){
+    if(str[0] < '0' || str[0] > '9' || str[1] < '0' || str[1] > '9'){
+        return false;
+    }
+    *value = (str[0] - '0') * 10 + (str[1] - '0');
+    return *value <= max;
+}
+
+static bool leap_year(uint32_t year){
+    return (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+}
+
+// parses "Sun, 06 Nov 1994 08:49:37 GMT", the day name is not checked
+static bool http_date_parse(const char *value, uint32_t *seconds){
+
+    if(value[3] != ',' || value[4] != ' ' || value[7] != ' ' || value[11] != ' ' || value[16] != ' ' ||
+       value[19] != ':' || value[22] != ':' || value[25] != ' ' ||
+       value[26] != 'G' || value[27] != 'M' || value[28] != 'T'){
+        return false;
+    }
+
+    uint32_t month;
+    for(month = 0; month != 12; ++month){
+        if(value[8] == months[month * 3] && value[9] == months[month * 3 + 1] && value[10] == months[month * 3 + 2]){
+            break;
+        }
+    }
+
+    uint32_t day, century, year, hour, minute, second;
+    if(month == 12 ||
+       !two_digits(value + 5, 31, &day) || day == 0 ||
+       !two_digits(value + 12, 99, &century) || !two_digits(value + 14, 99, &year) ||
+       !two_digits(value + 17, 23, &hour) || !two_digits(value + 20, 59, &minute) ||
+       !two_digits(value + 23, 60, &second)){
+        return false;
+    }
+
+    // a day past the end of its month would roll over into the next one
+    year += century * 100;
+    uint32_t days = month_days[month] + (month == 1 && leap_year(year));
+    if(day > days){
+        return false;
+    }
+
+    *seconds = http_date_days_from_civil(year, month + 1, day) * SECONDS_PER_DAY +
+               hour * SECONDS_PER_HOUR + minute * SECONDS_PER_MINUTE + second;
+    return true;
+}
+
+// the stream has to start at the beginning of a line, e.g. at the status line of a response
+void http_date_parser_init(http_date_parser_t *parser, http_date_fn date_fn){
+    parser->date_fn = date_fn;
+    parser->state = HTTP_DATE_NAME;
+    parser->index = 0;
+}
+
+// feeds the next bytes of the header stream, each byte is looked at exactly once
+void http_date_parser_feed(http_date_parser_t *parser, const char *data, uint16_t len){
+
+    uint16_t i;
+    for(i = 0; i != len; ++i){
+        char c = data[i];
+
+        switch(parser->state){
+        case HTTP_DATE_NAME:
+            // field names are case insensitive
+            if((c | 0x20) == date_name[parser->index]){
+                if(++parser->index == sizeof(date_name) - 1){
+                    parser->state = HTTP_DATE_SPACE;
+                }
+            }
+            else{
+                parser->state = (c == '\n')? HTTP_DATE_NAME: HTTP_DATE_SKIP_LINE;
+                parser->index = 0;
+            }
+            break;
+        case HTTP_DATE_SPACE:
+            if(c == ' ' || c == '\t'){
+                break;
+            }
+            parser->state = HTTP_DATE_VALUE;
+            parser->index = 0;
+            // fall through
+        case HTTP_DATE_VALUE:
+            if(c == '\r' || c == '\n'){
+                parser->state = (c == '\n')? HTTP_DATE_NAME: HTTP_DATE_SKIP_LINE;
+                parser->index = 0;
+                break;
+            }
+            parser->value[parser->index] = c;
+            if(++parser->index == HTTP_DATE_LEN){
+                uint32_t seconds;
+                if(http_date_parse(parser->value, &seconds) && parser->date_fn != NULL){
+                    parser->date_fn(seconds);
+                }
+                parser->state = HTTP_DATE_SKIP_LINE;
+                parser->index = 0;
+            }
+            break;
+        case HTTP_DATE_SKIP_LINE:
+            if(c == '\n'){
+                parser->state = HTTP_DATE_NAME;
+            }
+            break;
+        }
+    }
+}
@@ -0,0 +1,25 @@
+#ifndef HTTP_DATE_H
+#define HTTP_DATE_H
+
+#include <stdint.h>
+
+// length of an IMF-fixdate value, e.g. "Sun, 06 Nov 1994 08:49:37 GMT"
+#define HTTP_DATE_LEN 29
+
+// called with the date in unix seconds every time a complete Date field was parsed
+typedef void (*http_date_fn)(uint32_t seconds);
+
+// incremental parser for the Date field of an http header stream
+// the stream may be split anywhere and may contain several responses back to back
+typedef struct http_date_parser_t{
+    http_date_fn date_fn;
+    uint8_t state;
+    uint8_t index;
+    char value[HTTP_DATE_LEN];
+}http_date_parser_t;
+
+void http_date_parser_init(http_date_parser_t *parser, http_date_fn date_fn);
+void http_date_parser_feed(http_date_parser_t *parser, const char *data, uint16_t len);
+uint32_t http_date_days_from_civil(uint32_t year, uint32_t month, uint32_t day);
+
+#endif
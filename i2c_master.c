@@ -0,0 +1,207 @@
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "inc/hw_memmap.h"
+#include "inc/hw_ints.h"
+#include "inc/hw_types.h"
+#include "inc/hw_i2c.h"
+
+#include "driverlib/i2c.h"
+#include "driverlib/interrupt.h"
+#include "driverlib/sysctl.h"
+
+#include "i2c_master.h"
+#include "priorities.h"
+
+// a stuck bus must not block the caller forever
+#define I2C_MASTER_TIMEOUT_MILLISECONDS 100
+
+typedef struct i2c_transaction_t{
+    uint8_t prefix[I2C_MASTER_PREFIX_MAX];
+    uint8_t prefix_size;
+    uint8_t payload_size;
+    const uint8_t *payload;
+}i2c_transaction_t;
+
+extern uint32_t g_ui32SysClock;
+
+// transactions are sent back to back from the interrupt, the task only adds at l_head
+// and the interrupt only removes at l_tail
+static i2c_transaction_t l_queue[I2C_MASTER_QUEUE_SIZE];
+static volatile uint8_t l_head;
+static volatile uint8_t l_tail;
+// bytes of the transaction at l_tail already put into the TX FIFO
+static uint8_t l_sent;
+static volatile bool l_failed;
+static TaskHandle_t volatile l_waiting;
+// transactions that were not acknowledged
+static volatile uint32_t l_errors;
+static uint8_t l_slave_address;
+
+// puts as much of the transaction into the TX FIFO as fits
+// returns true once all of it is in the FIFO
+static bool i2c_master_fill(const i2c_transaction_t *transaction){
+    uint8_t size = transaction->prefix_size + transaction->payload_size;
+    while(l_sent != size){
+        uint8_t data = (l_sent < transaction->prefix_size)? transaction->prefix[l_sent]:
+                                                            transaction->payload[l_sent - transaction->prefix_size];
+        if(I2CFIFODataPutNonBlocking(I2C0_BASE, data) == 0){
+            return false;
+        }
+        ++l_sent;
+    }
+    return true;
+}
+
+// fills the TX FIFO with the start of one transaction and starts it
+// a transaction longer than the FIFO is refilled from the TX FIFO request interrupt,
+// so it goes out as one burst of any length, the data interrupt fires once all of it is sent
+static void i2c_master_start(const i2c_transaction_t *transaction){
+
+    I2CMasterBurstLengthSet(I2C0_BASE, transaction->prefix_size + transaction->payload_size);
+
+    l_sent = 0;
+    if(!i2c_master_fill(transaction)){
+        I2CMasterIntEnableEx(I2C0_BASE, I2C_MASTER_INT_TX_FIFO_REQ);
+    }
+
+    I2CMasterControl(I2C0_BASE, I2C_MASTER_CMD_FIFO_BURST_SEND_START);
+}
+
+// ISR for I2C0, refills the TX FIFO while a long transaction is sent,
+// then starts the next queued transaction or wakes up the task waiting for the queue
+void I2C0_handler(void){
+
+    uint32_t int_status = I2CMasterIntStatusEx(I2C0_BASE, true);
+    I2CMasterIntClearEx(I2C0_BASE, int_status);
+
+    // nothing in flight, e.g. after i2c_master_wait gave up on the transaction
+    if(l_tail == l_head){
+        I2CMasterIntDisableEx(I2C0_BASE, I2C_MASTER_INT_TX_FIFO_REQ);
+        return;
+    }
+
+    if(int_status & I2C_MASTER_INT_TX_FIFO_REQ){
+        if(i2c_master_fill(&l_queue[l_tail % I2C_MASTER_QUEUE_SIZE])){
+            I2CMasterIntDisableEx(I2C0_BASE, I2C_MASTER_INT_TX_FIFO_REQ);
+        }
+    }
+    if(!(int_status & (I2C_MASTER_INT_DATA | I2C_MASTER_INT_NACK))){
+        return;
+    }
+
+    if(I2CMasterErr(I2C0_BASE) != I2C_MASTER_ERR_NONE){
+        ++l_errors;
+        l_failed = true;
+        I2CMasterIntDisableEx(I2C0_BASE, I2C_MASTER_INT_TX_FIFO_REQ);
+        I2CTxFIFOFlush(I2C0_BASE);
+        I2CMasterControl(I2C0_BASE, I2C_MASTER_CMD_BURST_SEND_ERROR_STOP);
+    }
+
+    uint8_t tail = l_tail + 1;
+    l_tail = tail;
+
+    BaseType_t higher_priority_task_woken = pdFALSE;
+    if(tail != l_head){
+        i2c_master_start(&l_queue[tail % I2C_MASTER_QUEUE_SIZE]);
+    }
+    else if(l_waiting != NULL){
+        vTaskNotifyGiveIndexedFromISR(l_waiting, I2C_MASTER_NOTIFY_INDEX, &higher_priority_task_woken);
+        l_waiting = NULL;
+    }
+    portYIELD_FROM_ISR(higher_priority_task_woken);
+}
+
+// sets up the I2C master registers, after power on or after a reset of the peripheral
+static void i2c_master_configure(void){
+    I2CMasterInitExpClk(I2C0_BASE, g_ui32SysClock, false);
+    I2CMasterSlaveAddrSet(I2C0_BASE, l_slave_address, false);
+    // ask for more data while half of the FIFO is still queued, so the bus never waits for the refill
+    I2CTxFIFOConfigSet(I2C0_BASE, I2C_FIFO_CFG_TX_MASTER | I2C_FIFO_CFG_TX_TRIG_4);
+
+    I2CMasterIntClearEx(I2C0_BASE, I2CMasterIntStatusEx(I2C0_BASE, false));
+    I2CMasterIntEnableEx(I2C0_BASE, I2C_MASTER_INT_DATA | I2C_MASTER_INT_NACK);
+}
+
+// must be called from the task that uses the bus, before the scheduler needs it
+void i2c_master_init(uint8_t slave_address){
+    l_head = 0;
+    l_tail = 0;
+    l_failed = false;
+    l_waiting = NULL;
+    l_errors = 0;
+    l_slave_address = slave_address;
+
+    I2CIntRegister(I2C0_BASE, I2C0_handler);
+    IntPrioritySet(INT_I2C0_TM4C129, I2C0_INT_PRIORITY);
+    i2c_master_configure();
+}
+
+// blocks until every queued transaction was sent, without touching l_failed
+// if the interrupt never comes, the peripheral is reset so that a late interrupt from the
+// dropped transactions can neither start nor finish one of the next frame
+static void i2c_master_drain(void){
+
+    taskENTER_CRITICAL();
+    bool idle = l_head == l_tail;
+    if(!idle){
+        l_waiting = xTaskGetCurrentTaskHandle();
+    }
+    taskEXIT_CRITICAL();
+
+    if(!idle && ulTaskNotifyTakeIndexed(I2C_MASTER_NOTIFY_INDEX, pdTRUE, pdMS_TO_TICKS(I2C_MASTER_TIMEOUT_MILLISECONDS)) == 0){
+        taskENTER_CRITICAL();
+        SysCtlPeripheralReset(SYSCTL_PERIPH_I2C0);
+        IntPendClear(INT_I2C0_TM4C129);
+        i2c_master_configure();
+        l_waiting = NULL;
+        l_tail = l_head;
+        l_failed = true;
+        ++l_errors;
+        taskEXIT_CRITICAL();
+
+        // the interrupt may have given the notification after the wait timed out
+        ulTaskNotifyTakeIndexed(I2C_MASTER_NOTIFY_INDEX, pdTRUE, 0);
+    }
+}
+
+// queues one write transaction and returns right away
+// waits for the queue to drain first if it is full, a failure is kept for the next i2c_master_wait
+void i2c_master_write(const uint8_t *prefix, uint8_t prefix_size, const uint8_t *payload, uint8_t payload_size){
+
+    if((uint8_t)(l_head - l_tail) == I2C_MASTER_QUEUE_SIZE){
+        i2c_master_drain();
+    }
+
+    i2c_transaction_t *transaction = &l_queue[l_head % I2C_MASTER_QUEUE_SIZE];
+    uint8_t i;
+    for(i = 0; i != prefix_size; ++i){
+        transaction->prefix[i] = prefix[i];
+    }
+    transaction->prefix_size = prefix_size;
+    transaction->payload = payload;
+    transaction->payload_size = payload_size;
+
+    // the interrupt only starts the next transaction if the bus is already busy
+    taskENTER_CRITICAL();
+    bool idle = l_head == l_tail;
+    l_head = l_head + 1;
+    if(idle){
+        i2c_master_start(transaction);
+    }
+    taskEXIT_CRITICAL();
+}
+
+// blocks until every queued transaction was sent, the CPU is free for other tasks meanwhile
+// returns false if any of them was not acknowledged since the last call
+bool i2c_master_wait(void){
+
+    i2c_master_drain();
+
+    bool ok = !l_failed;
+    l_failed = false;
+    return ok;
+}
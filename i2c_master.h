@@ -0,0 +1,22 @@
+#ifndef I2C_MASTER_H
+#define I2C_MASTER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// task notification index used to wait for the I2C interrupt, index 0 is left to the tasks themselves
+#define I2C_MASTER_NOTIFY_INDEX 1
+
+// transactions that can be queued before i2c_master_write has to wait
+#define I2C_MASTER_QUEUE_SIZE 16
+
+// the prefix bytes are copied, the payload is only referenced and must not change until i2c_master_wait returns
+// prefix and payload together may be up to I2C_MASTER_TRANSACTION_MAX bytes, the burst length register is 8 bits
+#define I2C_MASTER_PREFIX_MAX 3
+#define I2C_MASTER_TRANSACTION_MAX 255
+
+void i2c_master_init(uint8_t slave_address);
+void i2c_master_write(const uint8_t *prefix, uint8_t prefix_size, const uint8_t *payload, uint8_t payload_size);
+bool i2c_master_wait(void);
+
+#endif
@@ -0,0 +1,57 @@
+#include <stdint.h>
+#include <string.h>
+
+#include "latency.h"
+#include "rtc_time.h"
+
+#define MICROSECONDS_PER_SECOND 1000000
+#define SECONDS_PER_MINUTE 60
+
+// minute boundary to the first frame that shows the new minute
+latency_stats_t g_latency_lcd;
+// minute boundary of an alarm to the buzzer being switched on
+latency_stats_t g_latency_alarm;
+
+void latency_init(latency_stats_t *stats){
+    memset(stats, 0, sizeof(*stats));
+}
+
+// microseconds since the current minute started by the RTC
+// every zone in tz_rules is a whole number of minutes away from UTC, so this holds for local time too
+uint32_t latency_since_minute(void){
+    uint32_t seconds;
+    uint32_t subseconds;
+    rtc_time_get(&seconds, &subseconds);
+    return (seconds % SECONDS_PER_MINUTE) * MICROSECONDS_PER_SECOND +
+           (uint32_t)((uint64_t)subseconds * MICROSECONDS_PER_SECOND / RTC_SUBSECONDS_PER_SECOND);
+}
+
+void latency_record(latency_stats_t *stats, uint32_t microseconds){
+    uint8_t bucket = 0;
+    uint32_t rest = microseconds;
+    while(rest != 0 && bucket != LATENCY_BUCKETS - 1){
+        rest >>= 1;
+        ++bucket;
+    }
+    ++stats->buckets[bucket];
+    ++stats->count;
+    if(microseconds > stats->max){
+        stats->max = microseconds;
+    }
+}
+
+// upper bound in microseconds of the bucket holding the given percentile, e.g. 50 or 99,
+// never more than the maximum seen
+uint32_t latency_percentile(const latency_stats_t *stats, uint8_t percent){
+    uint32_t target = (uint32_t)(((uint64_t)stats->count * percent + 99) / 100);
+    uint32_t seen = 0;
+    uint8_t bucket;
+    for(bucket = 0; bucket != LATENCY_BUCKETS - 1; ++bucket){
+        seen += stats->buckets[bucket];
+        if(seen >= target){
+            uint32_t bound = (bucket == 0)? 0: (uint32_t)1 << bucket;
+            return (bound < stats->max)? bound: stats->max;
+        }
+    }
+    return stats->max;
+}
@@ -0,0 +1,24 @@
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <stdint.h>
+
+// bucket i counts latencies of 2^(i - 1) up to 2^i microseconds, the last bucket takes everything longer
+#define LATENCY_BUCKETS 24
+
+// histogram of one path, written by a single task and read with the debugger
+typedef struct latency_stats_t{
+    uint32_t count;
+    uint32_t max;
+    uint32_t buckets[LATENCY_BUCKETS];
+}latency_stats_t;
+
+extern latency_stats_t g_latency_lcd;
+extern latency_stats_t g_latency_alarm;
+
+void latency_init(latency_stats_t *stats);
+uint32_t latency_since_minute(void);
+void latency_record(latency_stats_t *stats, uint32_t microseconds);
+uint32_t latency_percentile(const latency_stats_t *stats, uint8_t percent);
+
+#endif
@@ -1,5 +1,6 @@
 #include <stdint.h>
 #include <stdbool.h>
+#include <string.h>
 
 #include "FreeRTOS.h"
 #include "task.h"
@@ -14,12 +15,17 @@
 #include "driverlib/i2c.h"
 #include "driverlib/interrupt.h"
 #include "driverlib/sysctl.h"
+#include "driverlib/timer.h"
 
+#include "i2c_master.h"
+#include "latency.h"
 #include "time_struct.h"
 #include "priorities.h"
 #include "button_pins.h"
 
-#define LCD_TASK_SIZE_WORDS 100
+// a button press adds the alarm from this task, alarm_user_set down to tz_cache_fill takes about 120 words
+// of frames plus 17 words of saved context, so this leaves a quarter spare
+#define LCD_TASK_SIZE_WORDS 176
 
 #define LCD_I2C_SLAVE_ADDRESS 0x3c
 
@@ -30,17 +36,54 @@
 #define LCD_COMMAND_ENTRY_MODE_SET 0x06
 #define LCD_COMMAND_LINE_1 0x80
 #define LCD_COMMAND_LINE_2 0xc0
+#define LCD_COMMAND_SET_CGRAM 0x40
 
 #define LCD_CO 0x80
 
 #define LCD_A0_COMMAND 0x00
 #define LCD_A0_DATA 0x40
 
-#define DEBOUNCE_TIME_MILLISECONDS 100
-#define LCD_DELAY_MICROSECONDS 500
-
-#define SYSCTL_DELAY_MILISECONDS_FACTOR (configCPU_CLOCK_HZ / 3000)
-#define SYSCTL_DELAY_MICROSECONDS_FACTOR (SYSCTL_DELAY_MILISECONDS_FACTOR / 1000)
+#define LCD_LINES 2
+#define LCD_COLUMNS 16
+
+// custom characters in CGRAM, 8 rows of 5 pixels each
+// character 0 is left unused so that a zeroed l_lcd_shown never matches a frame
+#define LCD_GLYPH_ROWS 8
+#define LCD_GLYPH_BELL 1
+
+// layout of the two lines, "Now: 12:34 PST [bell]" and "Alarm: 12:34 PST" or "Select:12:34 PST"
+#define LCD_LABEL_LEN 5
+#define LCD_SELECT_LABEL_LEN 7
+#define LCD_BELL_COLUMN 15
+
+#define LCD_DIGITS_ROW(tens) {tens, '0'}, {tens, '1'}, {tens, '2'}, {tens, '3'}, {tens, '4'}, \
+                             {tens, '5'}, {tens, '6'}, {tens, '7'}, {tens, '8'}, {tens, '9'}
+
+// changed runs separated by at most this many unchanged cells are sent as one run,
+// since resending a few characters is cheaper than another transaction with its own address
+#define LCD_RUN_MERGE_GAP 4
+
+// invalidations closer together than one frame are drawn as a single frame
+#define LCD_FRAME_MILLISECONDS 20
+
+// the buttons are sampled every DEBOUNCE_SAMPLE_MILLISECONDS while any of them is pressed or bouncing,
+// a button changes state after 4 equal samples in a row
+#define DEBOUNCE_SAMPLE_MILLISECONDS 5
+#define BUTTON_PINS (HOUR_UP_PIN | HOUR_DOWN_PIN | MINUTE_UP_PIN | MINUTE_DOWN_PIN | ALARM_SET_PIN)
+// number of presses that can wait for lcd_task, must be a power of 2
+#define BUTTON_QUEUE_SIZE 16
+
+// holding one of the time buttons repeats it, first after REPEAT_DELAY_MILLISECONDS and then every
+// REPEAT_PERIOD_MILLISECONDS, and once it has been held for REPEAT_FAST_MILLISECONDS the minute buttons
+// move by REPEAT_FAST_MINUTES per repeat
+#define BUTTON_REPEAT_PINS (HOUR_UP_PIN | HOUR_DOWN_PIN | MINUTE_UP_PIN | MINUTE_DOWN_PIN)
+#define REPEAT_DELAY_MILLISECONDS 400
+#define REPEAT_PERIOD_MILLISECONDS 100
+#define REPEAT_FAST_MILLISECONDS 2000
+#define REPEAT_FAST_MINUTES 10
+#define REPEAT_DELAY_SAMPLES (REPEAT_DELAY_MILLISECONDS / DEBOUNCE_SAMPLE_MILLISECONDS)
+#define REPEAT_PERIOD_SAMPLES (REPEAT_PERIOD_MILLISECONDS / DEBOUNCE_SAMPLE_MILLISECONDS)
+#define REPEAT_FAST_SAMPLES (REPEAT_FAST_MILLISECONDS / DEBOUNCE_SAMPLE_MILLISECONDS)
 
 typedef enum button_event_t{
     ALARM_SET,
@@ -48,249 +91,429 @@ typedef enum button_event_t{
     HOUR_DOWN,
     MINUTE_UP,
     MINUTE_DOWN,
-    IDLE
+    BUTTON_COUNT,
+    // not a button of its own, any time button pressed while the alarm rings
+    ALARM_SNOOZE = BUTTON_COUNT
 }button_event_t;
 
+// step is how far a time button moves the user time, 1 for a press and more for fast repeats
+typedef struct button_press_t{
+    button_event_t button;
+    uint8_t step;
+    TickType_t time;
+}button_press_t;
+
 extern uint32_t g_ui32SysClock;
 extern time_t g_cur_time;
+extern const char *g_cur_zone;
 
 extern volatile bool alarm_ringing;
 
+extern void alarm_user_set(bool set);
+extern void alarm_user_snooze(void);
+
 TaskHandle_t lcd_task_handle;
 
 volatile bool alarm_set;
 volatile time_t user_time;
-static volatile button_event_t cur_button;
 
-// ISR for the buttons, sets the cur_button variable and then
-// allows one loop of lcd_task to execute
+static const uint8_t l_lcd_line_commands[LCD_LINES] = {LCD_COMMAND_LINE_1, LCD_COMMAND_LINE_2};
+
+static const char l_label_now[LCD_LABEL_LEN] = {'N', 'o', 'w', ':', ' '};
+static const char l_label_alarm[LCD_SELECT_LABEL_LEN] = {'A', 'l', 'a', 'r', 'm', ':', ' '};
+static const char l_label_select[LCD_SELECT_LABEL_LEN] = {'S', 'e', 'l', 'e', 'c', 't', ':'};
+static const char l_label_connecting[] = "Connecting...";
+
+// "00" to "99", so a time is drawn with two table copies instead of divisions
+static const char l_two_digits[100][2] = {
+    LCD_DIGITS_ROW('0'), LCD_DIGITS_ROW('1'), LCD_DIGITS_ROW('2'), LCD_DIGITS_ROW('3'), LCD_DIGITS_ROW('4'),
+    LCD_DIGITS_ROW('5'), LCD_DIGITS_ROW('6'), LCD_DIGITS_ROW('7'), LCD_DIGITS_ROW('8'), LCD_DIGITS_ROW('9')
+};
+
+// bell shown while an alarm is armed
+static const char l_glyph_bell[LCD_GLYPH_ROWS] = {0x04, 0x0e, 0x0e, 0x0e, 0x1f, 0x00, 0x04, 0x00};
+
+// what the lcd currently shows, and the frame lcd_flush makes it show
+static char l_lcd_shown[LCD_LINES][LCD_COLUMNS];
+static char l_lcd_frame[LCD_LINES][LCD_COLUMNS];
+
+static const uint8_t l_button_pins[BUTTON_COUNT] = {
+    [ALARM_SET] = ALARM_SET_PIN,
+    [HOUR_UP] = HOUR_UP_PIN,
+    [HOUR_DOWN] = HOUR_DOWN_PIN,
+    [MINUTE_UP] = MINUTE_UP_PIN,
+    [MINUTE_DOWN] = MINUTE_DOWN_PIN
+};
+
+// single producer single consumer ring of presses, the debounce ISR only writes l_button_head
+// and lcd_task only writes l_button_tail, so neither side needs to lock the other out
+// the indices run freely and are masked on access
+static volatile button_press_t l_button_queue[BUTTON_QUEUE_SIZE];
+static volatile uint8_t l_button_head;
+static volatile uint8_t l_button_tail;
+
+// render scheduler counters: frames drawn, invalidations folded into another frame,
+// and frames the lcd missed because the i2c transfer failed
+static uint32_t l_lcd_frames;
+static uint32_t l_lcd_frames_merged;
+static uint32_t l_lcd_frames_dropped;
+
+// minute shown by the last frame, to time how late a new minute reaches the lcd
+static uint8_t l_lcd_shown_minute;
+// presses dropped because the queue was full
+static volatile uint32_t l_button_dropped;
+
+// debounced state of the button pins, and a 2 bit vertical counter per pin
+// counting how many samples in a row differed from it
+static uint8_t l_debounce_state;
+static uint8_t l_debounce_count_0;
+static uint8_t l_debounce_count_1;
+
+// samples each button has been held down for, up to REPEAT_FAST_SAMPLES,
+// and samples left until its next repeat
+static uint16_t l_hold_samples[BUTTON_COUNT];
+static uint8_t l_repeat_countdown[BUTTON_COUNT];
+
+// ISR for the buttons, only wakes up the debounce timer
+// the edge interrupt stays off until all buttons are released and stable again
 void GPIO_PK_handler(void){
+    GPIOIntDisable(GPIO_PORTK_BASE, BUTTON_PINS);
+    GPIOIntClear(GPIO_PORTK_BASE, BUTTON_PINS);
+    TimerEnable(TIMER0_BASE, TIMER_A);
+}
 
-    GPIOIntDisable(GPIO_PORTK_BASE, HOUR_UP_PIN | HOUR_DOWN_PIN | MINUTE_UP_PIN | MINUTE_DOWN_PIN | ALARM_SET_PIN);
+// marks the lcd as out of date, lcd_task redraws it within one frame window
+void lcd_invalidate(void){
+    xTaskNotifyGive(lcd_task_handle);
+}
 
-    // debounce the button inputs
-    SysCtlDelay(SYSCTL_DELAY_MILISECONDS_FACTOR * DEBOUNCE_TIME_MILLISECONDS);
-    uint32_t int_status = GPIOIntStatus(GPIO_PORTK_BASE, false);
-    uint32_t gpio_in = GPIOPinRead(GPIO_PORTK_BASE, HOUR_UP_PIN | HOUR_DOWN_PIN | MINUTE_UP_PIN | MINUTE_DOWN_PIN | ALARM_SET_PIN);
+// same as lcd_invalidate, for interrupt handlers
+void lcd_invalidate_from_isr(BaseType_t *higher_priority_task_woken){
+    vTaskNotifyGiveFromISR(lcd_task_handle, higher_priority_task_woken);
+}
 
-    if((int_status & HOUR_UP_PIN) && (gpio_in & HOUR_UP_PIN)){
-        cur_button = HOUR_UP;
+// called from the debounce ISR only
+static void button_queue_push(button_event_t button, uint8_t step, TickType_t time){
+    uint8_t head = l_button_head;
+    if((uint8_t)(head - l_button_tail) == BUTTON_QUEUE_SIZE){
+        ++l_button_dropped;
+        return;
     }
-    else if((int_status & HOUR_DOWN_PIN) && (gpio_in & HOUR_DOWN_PIN)){
-        cur_button = HOUR_DOWN;
+    l_button_queue[head & (BUTTON_QUEUE_SIZE - 1)].button = button;
+    l_button_queue[head & (BUTTON_QUEUE_SIZE - 1)].step = step;
+    l_button_queue[head & (BUTTON_QUEUE_SIZE - 1)].time = time;
+    l_button_head = head + 1;
+}
+
+// called from lcd_task only
+static bool button_queue_pop(button_press_t *press){
+    uint8_t tail = l_button_tail;
+    if(tail == l_button_head){
+        return false;
     }
-    else if((int_status & MINUTE_UP_PIN) && (gpio_in & MINUTE_UP_PIN)){
-        cur_button = MINUTE_UP;
+    *press = l_button_queue[tail & (BUTTON_QUEUE_SIZE - 1)];
+    l_button_tail = tail + 1;
+    return true;
+}
+
+// ISR for the debounce timer, samples all button pins at once
+// every debounced press and every repeat of a held time button is queued with its tick count
+// and lcd_task is notified
+// while the alarm rings ALARM_SET stops it and any time button snoozes it, nothing else is accepted
+// the timer keeps running for as long as any button is down, so holds need no extra interrupts
+void TIMER0A_handler(void){
+
+    TimerIntClear(TIMER0_BASE, TIMER_TIMA_TIMEOUT);
+
+    uint8_t sample = GPIOPinRead(GPIO_PORTK_BASE, BUTTON_PINS);
+
+    // pins that equal the debounced state reset their counter, the others count up
+    // and toggle the state when the counter wraps around
+    uint8_t delta = sample ^ l_debounce_state;
+    l_debounce_count_1 = (l_debounce_count_1 ^ l_debounce_count_0) & delta;
+    l_debounce_count_0 = ~l_debounce_count_0 & delta;
+    uint8_t toggle = delta & ~(l_debounce_count_0 | l_debounce_count_1);
+    l_debounce_state ^= toggle;
+
+    uint8_t pressed = toggle & l_debounce_state;
+    uint8_t held = l_debounce_state & ~pressed & BUTTON_REPEAT_PINS;
+    bool snooze = false;
+    if(alarm_ringing){
+        snooze = (pressed & ALARM_SET_PIN) == 0 && (pressed & BUTTON_REPEAT_PINS) != 0;
+        pressed &= ALARM_SET_PIN;
+        held = 0;
     }
-    else if((int_status & MINUTE_DOWN_PIN) && (gpio_in & MINUTE_DOWN_PIN)){
-        cur_button = MINUTE_DOWN;
+    // the time buttons do nothing in alarm mode, so there is nothing to repeat
+    if(alarm_set){
+        held = 0;
     }
-    else if((int_status & ALARM_SET_PIN) && (gpio_in & ALARM_SET_PIN)){
-        alarm_ringing = false;
-        cur_button = ALARM_SET;
+    BaseType_t higher_priority_task_woken = pdFALSE;
+    if(pressed | held | snooze){
+        TickType_t now = xTaskGetTickCountFromISR();
+        bool queued = false;
+        uint8_t button;
+        for(button = 0; button != BUTTON_COUNT; ++button){
+            if(pressed & l_button_pins[button]){
+                button_queue_push((button_event_t)button, 1, now);
+                l_hold_samples[button] = 0;
+                l_repeat_countdown[button] = REPEAT_DELAY_SAMPLES;
+                queued = true;
+            }
+            else if(held & l_button_pins[button]){
+                if(l_hold_samples[button] != REPEAT_FAST_SAMPLES){
+                    ++l_hold_samples[button];
+                }
+                if(--l_repeat_countdown[button] == 0){
+                    l_repeat_countdown[button] = REPEAT_PERIOD_SAMPLES;
+                    uint8_t step = 1;
+                    if(l_hold_samples[button] == REPEAT_FAST_SAMPLES && (button == MINUTE_UP || button == MINUTE_DOWN)){
+                        step = REPEAT_FAST_MINUTES;
+                    }
+                    button_queue_push((button_event_t)button, step, now);
+                    queued = true;
+                }
+            }
+        }
+        if(pressed & ALARM_SET_PIN){
+            alarm_ringing = false;
+        }
+        if(snooze){
+            button_queue_push(ALARM_SNOOZE, 1, now);
+            alarm_ringing = false;
+            queued = true;
+        }
+
+        if(queued){
+            lcd_invalidate_from_isr(&higher_priority_task_woken);
+        }
     }
 
-    vTaskResume(lcd_task_handle);
+    // everything released and stable: stop sampling and wait for the next edge
+    if(l_debounce_state == 0 && sample == 0){
+        GPIOIntClear(GPIO_PORTK_BASE, BUTTON_PINS);
+        GPIOIntEnable(GPIO_PORTK_BASE, BUTTON_PINS);
+        if(GPIOPinRead(GPIO_PORTK_BASE, BUTTON_PINS) == 0){
+            TimerDisable(TIMER0_BASE, TIMER_A);
+        }
+        else{
+            // a press started in between, keep sampling
+            GPIOIntDisable(GPIO_PORTK_BASE, BUTTON_PINS);
+        }
+    }
 
+    portYIELD_FROM_ISR(higher_priority_task_woken);
 }
 
-static inline void i2c_init(void){
-    I2CMasterInitExpClk(I2C0_BASE, g_ui32SysClock, false);
-    I2CMasterSlaveAddrSet(I2C0_BASE, LCD_I2C_SLAVE_ADDRESS, false);
-    I2CTxFIFOConfigSet(I2C0_BASE, I2C_FIFO_CFG_TX_MASTER);
+// queue a command to the lcd, sent by the i2c interrupt
+static inline void lcd_send_command(uint8_t command){
+    const uint8_t prefix[2] = {LCD_A0_COMMAND, command};
+    i2c_master_write(prefix, 2, NULL, 0);
 }
 
-// send command to lcd via i2c fifo
-static inline void lcd_send_command(uint8_t command){
-    I2CMasterBurstLengthSet(I2C0_BASE, 0x02);
+// queue character data to the lcd at the address set by an address command, all in one transaction
+// the control byte with LCD_CO set is followed by the command and another control byte, the last control
+// byte starts the data, which may be any length because the i2c interrupt refills the fifo
+// the data must stay unchanged until i2c_master_wait returns
+static inline void lcd_send_data(uint8_t address_command, const char *data, uint8_t size){
+    const uint8_t prefix[3] = {LCD_CO | LCD_A0_COMMAND, address_command, LCD_A0_DATA};
+    i2c_master_write(prefix, 3, (const uint8_t*)data, size);
+}
 
-    I2CFIFODataPut(I2C0_BASE, LCD_A0_COMMAND);
-    I2CFIFODataPut(I2C0_BASE, command);
+// sends only the cells of l_lcd_frame that differ from l_lcd_shown
+// every run of changed cells costs one transaction, so a full line is a single transaction
+// all transactions are queued at once and the task sleeps until the i2c interrupt has sent them
+// returns false if the lcd missed part of the frame
+static bool lcd_flush(void){
 
-    I2CMasterControl(I2C0_BASE, I2C_MASTER_CMD_FIFO_BURST_SEND_START);
+    uint8_t line;
+    for(line = 0; line != LCD_LINES; ++line){
 
-    while(I2CMasterBusy(I2C0_BASE)){
-        SysCtlDelay(SYSCTL_DELAY_MICROSECONDS_FACTOR * LCD_DELAY_MICROSECONDS);
-    }
-}
+        uint16_t dirty = 0;
+        uint8_t column;
+        for(column = 0; column != LCD_COLUMNS; ++column){
+            if(l_lcd_frame[line][column] != l_lcd_shown[line][column]){
+                dirty |= 1 << column;
+            }
+        }
 
-// send character data to lcd via i2c fifo, maximum of 7 characters at a time
-static inline void lcd_send_data(char *data, uint8_t size){
-    I2CMasterBurstLengthSet(I2C0_BASE, size + 0x01);
+        column = 0;
+        while(dirty >> column){
+            while(!(dirty & (1 << column))){
+                ++column;
+            }
 
-    I2CFIFODataPut(I2C0_BASE, LCD_A0_DATA);
+            // extend the run over small gaps of unchanged cells
+            uint8_t start = column;
+            uint8_t last = column;
+            for(++column; column != LCD_COLUMNS && column - last <= LCD_RUN_MERGE_GAP + 1; ++column){
+                if(dirty & (1 << column)){
+                    last = column;
+                }
+            }
+            column = last + 1;
 
-    uint8_t i;
-    for(i = 0; i != size; ++i){
-        I2CFIFODataPut(I2C0_BASE, data[i]);
-    }
+            lcd_send_data(l_lcd_line_commands[line] + start, &l_lcd_frame[line][start], column - start);
 
-    I2CMasterControl(I2C0_BASE, I2C_MASTER_CMD_FIFO_BURST_SEND_START);
+            memcpy(&l_lcd_shown[line][start], &l_lcd_frame[line][start], column - start);
+        }
+    }
 
-    while(I2CMasterBusy(I2C0_BASE)){
-        SysCtlDelay(SYSCTL_DELAY_MICROSECONDS_FACTOR * LCD_DELAY_MICROSECONDS);
+    // if the lcd missed anything, redraw everything with the next frame
+    if(!i2c_master_wait()){
+        memset(l_lcd_shown, 0, sizeof(l_lcd_shown));
+        return false;
     }
+    return true;
 }
 
 static inline void lcd_init(void){
     lcd_send_command(LCD_COMMAND_FUNCTION_SET);
+    i2c_master_wait();
     vTaskDelay(1 / portTICK_PERIOD_MS);
 
     lcd_send_command(LCD_COMMAND_DISPLAY_ON);
+    i2c_master_wait();
     vTaskDelay(1 / portTICK_PERIOD_MS);
 
     lcd_send_command(LCD_COMMAND_CLEAR_DISPLAY);
+    i2c_master_wait();
     vTaskDelay(10 / portTICK_PERIOD_MS);
 
     lcd_send_command(LCD_COMMAND_ENTRY_MODE_SET);
+    i2c_master_wait();
     vTaskDelay(1 / portTICK_PERIOD_MS);
 
-    char buf[16] = "Connecting...";
+    // the custom characters are uploaded once, they stay in CGRAM as long as the lcd has power
+    lcd_send_data(LCD_COMMAND_SET_CGRAM | (LCD_GLYPH_BELL * LCD_GLYPH_ROWS), l_glyph_bell, LCD_GLYPH_ROWS);
 
-    lcd_send_data(buf, 7);
-    vTaskDelay(1 / portTICK_PERIOD_MS);
+    // the display is blank after the clear command
+    memset(l_lcd_shown, ' ', sizeof(l_lcd_shown));
+    memset(l_lcd_frame, ' ', sizeof(l_lcd_frame));
+    memcpy(l_lcd_frame[0], l_label_connecting, sizeof(l_label_connecting) - 1);
 
-    lcd_send_data(buf + 7, 6);
-    vTaskDelay(1 / portTICK_PERIOD_MS);
+    lcd_flush();
 }
 
-// fills a given char buffer with the time
-static void lcd_fill_time(volatile time_t *time, char *buf){
+// fills a given char buffer with the time and the zone abbreviation
+static void lcd_fill_time(volatile time_t *time, const char *zone, char *buf){
+    memcpy(buf, l_two_digits[time->hour], 2);
+    buf[2] = ':';
+    memcpy(buf + 3, l_two_digits[time->minute], 2);
+    buf[5] = ' ';
+    buf[6] = zone[0];
+    buf[7] = zone[1];
+    buf[8] = zone[2];
+}
 
-    uint8_t hour_ones = time->hour;
-    uint8_t hour_tens = 0;
-    while(hour_ones > 9){
-        hour_ones -= 10;
-        ++hour_tens;
-    }
+// draws the times into the frame and sends the cells that changed to the lcd via i2c
+static inline bool lcd_update(void){
 
-    uint8_t minute_ones = time->minute;
-    uint8_t minute_tens = 0;
-    while(minute_ones > 9){
-        minute_ones -= 10;
-        ++minute_tens;
-    }
+    char *buf = l_lcd_frame[0];
+    memcpy(buf, l_label_now, LCD_LABEL_LEN);
+    lcd_fill_time(&g_cur_time, g_cur_zone, buf + LCD_LABEL_LEN);
+    buf[LCD_BELL_COLUMN - 1] = ' ';
+    buf[LCD_BELL_COLUMN] = (alarm_set == true)? LCD_GLYPH_BELL: ' ';
 
-    buf[0] = '0' + hour_tens;
-    buf[1] = '0' + hour_ones;
-    buf[2] = ':';
-    buf[3] = '0' + minute_tens;
-    buf[4] = '0' + minute_ones;
-    buf[5] = ' ';
-    buf[6] = 'P';
-    buf[7] = 'S';
-    buf[8] = 'T';
+    buf = l_lcd_frame[1];
+    memcpy(buf, (alarm_set == true)? l_label_alarm: l_label_select, LCD_SELECT_LABEL_LEN);
+    lcd_fill_time(&user_time, g_cur_zone, buf + LCD_SELECT_LABEL_LEN);
+
+    return lcd_flush();
 }
 
-// writes the times to the entire 16x2 lcd via i2c
-static inline void lcd_update(void){
-    lcd_send_command(LCD_COMMAND_LINE_1);
-    SysCtlDelay(SYSCTL_DELAY_MICROSECONDS_FACTOR * LCD_DELAY_MICROSECONDS);
-
-    char buf[16];
-    buf[0] = 'N';
-    buf[1] = 'o';
-    buf[2] = 'w';
-    buf[3] = ':';
-    buf[4] = ' ';
-
-    lcd_fill_time(&g_cur_time, buf + 5);
-
-    lcd_send_data(buf, 7);
-    SysCtlDelay(SYSCTL_DELAY_MICROSECONDS_FACTOR * LCD_DELAY_MICROSECONDS);
-    lcd_send_data(buf + 7, 7);
-    SysCtlDelay(SYSCTL_DELAY_MICROSECONDS_FACTOR * LCD_DELAY_MICROSECONDS);
-
-    lcd_send_command(LCD_COMMAND_LINE_2);
-    SysCtlDelay(SYSCTL_DELAY_MICROSECONDS_FACTOR * LCD_DELAY_MICROSECONDS);
-
-    if(alarm_set == true){
-        buf[0] = 'A';
-        buf[1] = 'l';
-        buf[2] = 'a';
-        buf[3] = 'r';
-        buf[4] = 'm';
-        buf[5] = ':';
-        buf[6] = ' ';
+// applies one button press, or one repeat of size step, to user_time or alarm_set
+// the minute wraps around without changing the hour
+static void lcd_handle_button(button_event_t button, uint8_t step){
+
+    if(alarm_set == false){
+        switch(button){
+        case HOUR_UP:
+            user_time.hour = (user_time.hour + step) % 24;
+            break;
+        case HOUR_DOWN:
+            user_time.hour = (user_time.hour + 24 - step) % 24;
+            break;
+        case MINUTE_UP:
+            user_time.minute = (user_time.minute + step) % 60;
+            break;
+        case MINUTE_DOWN:
+            user_time.minute = (user_time.minute + 60 - step) % 60;
+            break;
+        case ALARM_SET:
+            alarm_set = true;
+            alarm_user_set(true);
+            break;
+        default:
+            break;
+        }
     }
     else{
-        buf[0] = 'S';
-        buf[1] = 'e';
-        buf[2] = 'l';
-        buf[3] = 'e';
-        buf[4] = 'c';
-        buf[5] = 't';
-        buf[6] = ':';
+        switch(button){
+        case ALARM_SET:
+            alarm_set = false;
+            alarm_user_set(false);
+            break;
+        case ALARM_SNOOZE:
+            alarm_user_snooze();
+            break;
+        default:
+            break;
+        }
     }
-
-    lcd_fill_time(&user_time, buf + 7);
-
-    lcd_send_data(buf, 7);
-    SysCtlDelay(SYSCTL_DELAY_MICROSECONDS_FACTOR * LCD_DELAY_MICROSECONDS);
-    lcd_send_data(buf + 7, 7);
-    SysCtlDelay(SYSCTL_DELAY_MICROSECONDS_FACTOR * LCD_DELAY_MICROSECONDS);
-    lcd_send_data(buf + 14, 2);
-    SysCtlDelay(SYSCTL_DELAY_MICROSECONDS_FACTOR * LCD_DELAY_MICROSECONDS);
-
 }
 
 // updates the lcd when necessary
 void lcd_task(void *args){
 
-    i2c_init();
+    i2c_master_init(LCD_I2C_SLAVE_ADDRESS);
     lcd_init();
 
-    // wait for DHCP to complete
+    // wait for the first time, time_task invalidates the lcd as soon as it has one, which is right
+    // after reset if the RTC kept running, or else after DHCP and the first network sample
     while(g_cur_time.hour == UNSET_HOUR){
-        vTaskDelay(250 / portTICK_PERIOD_MS);
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
     }
 
-    // this loop executes only once every time a change happens to g_cur_time or user_time,
-    // since that is when the lcd display needs to be updated
-    // the GPIO interrupt remains disabled here to prevent double interrupts, which causes problems
-    while(1){
+    GPIOIntClear(GPIO_PORTK_BASE, BUTTON_PINS);
+    GPIOIntEnable(GPIO_PORTK_BASE, BUTTON_PINS);
 
-        if(alarm_set == false){
-            switch(cur_button){
-            case HOUR_UP:
-                user_time.hour = (user_time.hour == 23)? 0: user_time.hour + 1;
-                break;
-            case HOUR_DOWN:
-                user_time.hour = (user_time.hour == 0)? 23: user_time.hour - 1;
-                break;
-            case MINUTE_UP:
-                user_time.minute = (user_time.minute == 59)? 0: user_time.minute + 1;
-                break;
-            case MINUTE_DOWN:
-                user_time.minute = (user_time.minute == 0)? 59: user_time.minute - 1;
-                break;
-            case ALARM_SET:
-                alarm_set = true;
-                break;
-            case IDLE:
-                break;
-            }
-        }
-        else{
-            switch(cur_button){
-            case ALARM_SET:
-                alarm_set = false;
-                break;
-            default:
-                break;
-            }
+    lcd_update();
+    l_lcd_shown_minute = g_cur_time.minute;
+    TickType_t last_frame = xTaskGetTickCount();
 
-        }
+    // this loop draws one frame for every burst of invalidations, which happen whenever
+    // g_cur_time changes or a button is pressed
+    // the notification value counts the invalidations, so everything that arrives before the
+    // frame window since the last frame has passed is folded into the same frame
+    // all presses queued since the last update are applied before the lcd is written once
+    while(1){
 
-        cur_button = IDLE;
+        uint32_t invalidations = ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
 
-        lcd_update();
+        TickType_t elapsed = xTaskGetTickCount() - last_frame;
+        if(elapsed < pdMS_TO_TICKS(LCD_FRAME_MILLISECONDS)){
+            vTaskDelay(pdMS_TO_TICKS(LCD_FRAME_MILLISECONDS) - elapsed);
+            invalidations += ulTaskNotifyTake(pdTRUE, 0);
+        }
+        l_lcd_frames_merged += invalidations - 1;
 
-        GPIOIntClear(GPIO_PORTK_BASE, HOUR_UP_PIN | HOUR_DOWN_PIN | MINUTE_UP_PIN | MINUTE_DOWN_PIN | ALARM_SET_PIN);
-        while(GPIOIntStatus(GPIO_PORTK_BASE, false) & (HOUR_UP_PIN | HOUR_DOWN_PIN | MINUTE_UP_PIN | MINUTE_DOWN_PIN | ALARM_SET_PIN)){}
-        GPIOIntEnable(GPIO_PORTK_BASE, HOUR_UP_PIN | HOUR_DOWN_PIN | MINUTE_UP_PIN | MINUTE_DOWN_PIN | ALARM_SET_PIN);
+        button_press_t press;
+        while(button_queue_pop(&press)){
+            lcd_handle_button(press.button, press.step);
+        }
 
-        vTaskSuspend(NULL);
+        last_frame = xTaskGetTickCount();
+        if(!lcd_update()){
+            ++l_lcd_frames_dropped;
+        }
+        else if(g_cur_time.minute != l_lcd_shown_minute){
+            // only a minute that simply ticked over has a boundary to measure from, not a stepped clock
+            if(g_cur_time.minute == (l_lcd_shown_minute + 1) % 60){
+                latency_record(&g_latency_lcd, latency_since_minute());
+            }
+            l_lcd_shown_minute = g_cur_time.minute;
+        }
+        ++l_lcd_frames;
     }
 }
 
@@ -300,10 +523,22 @@ void inline lcd_task_init(void){
     GPIOIntRegister(GPIO_PORTK_BASE, GPIO_PK_handler);
     IntPrioritySet(INT_GPIOK_TM4C129, GPIO_PK_INT_PRIORITY);
 
+    TimerConfigure(TIMER0_BASE, TIMER_CFG_PERIODIC);
+    TimerLoadSet(TIMER0_BASE, TIMER_A, g_ui32SysClock / 1000 * DEBOUNCE_SAMPLE_MILLISECONDS);
+    TimerIntRegister(TIMER0_BASE, TIMER_A, TIMER0A_handler);
+    TimerIntEnable(TIMER0_BASE, TIMER_TIMA_TIMEOUT);
+    IntPrioritySet(INT_TIMER0A_TM4C129, DEBOUNCE_INT_PRIORITY);
+    latency_init(&g_latency_lcd);
+    l_debounce_state = 0;
+    l_debounce_count_0 = 0;
+    l_debounce_count_1 = 0;
+
     user_time.hour = 0;
     user_time.minute = 0;
     alarm_set = false;
-    cur_button = IDLE;
+    l_button_head = 0;
+    l_button_tail = 0;
+    l_button_dropped = 0;
 
     xTaskCreate(lcd_task, "lcd_task", LCD_TASK_SIZE_WORDS, NULL, PRIORITY_LCD_TASK, &lcd_task_handle);
 }
@@ -49,7 +49,11 @@
                          EMAC_PHY_AN_100B_T_FULL_DUPLEX)
 #define PHY_PHYS_ADDR      0
 #define NUM_TX_DESCRIPTORS 24
-#define NUM_RX_DESCRIPTORS 8
+// the netif driver hands every rx descriptor a pbuf from the pool for the DMA
+// to write into and passes it up without a copy, so more descriptors cost no
+// extra buffers, they only lend more of the pool to the ring
+// a full frame takes 3 pool pbufs, so 16 descriptors hold 5 frames at once
+#define NUM_RX_DESCRIPTORS 16
 
 //*****************************************************************************
 //
@@ -92,7 +96,7 @@
 //#define MEMP_NUM_REASSDATA              5
 //#define MEMP_NUM_ARP_QUEUE              30
 //#define MEMP_NUM_IGMP_GROUP             8
-#define MEMP_NUM_SYS_TIMEOUT              8
+#define MEMP_NUM_SYS_TIMEOUT              9     // one more for the SNTP client
 //#define MEMP_NUM_NETBUF                 2
 //#define MEMP_NUM_NETCONN                4
 //#define MEMP_NUM_TCPIP_MSG_API          8
@@ -372,13 +376,20 @@
 // ---------- checksum options ----------
 //
 //*****************************************************************************
+// the EMAC inserts every checksum on transmit and drops received frames with
+// bad checksums in hardware, so lwIP neither generates nor checks any
+// with CHECKSUM_OFFLOAD_VERIFY set, the EMAC passes frames with bad checksums
+// on and lwIP checks them in software instead, so every frame the offload
+// would have dropped is counted in lwip_stats ip.chkerr, udp.chkerr and
+// tcp.chkerr, or in link.drop if the driver rejects it by its rx status
+#define CHECKSUM_OFFLOAD_VERIFY         0
 #define CHECKSUM_GEN_IP                 0
 #define CHECKSUM_GEN_ICMP               0
 #define CHECKSUM_GEN_UDP                0
 #define CHECKSUM_GEN_TCP                0
-#define CHECKSUM_CHECK_IP               0
-#define CHECKSUM_CHECK_UDP              0
-#define CHECKSUM_CHECK_TCP              0
+#define CHECKSUM_CHECK_IP               CHECKSUM_OFFLOAD_VERIFY
+#define CHECKSUM_CHECK_UDP              CHECKSUM_OFFLOAD_VERIFY
+#define CHECKSUM_CHECK_TCP              CHECKSUM_OFFLOAD_VERIFY
 
 //*****************************************************************************
 //
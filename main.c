@@ -75,6 +75,7 @@ extern uint32_t lwIPTaskInit(void);
 extern void time_task_init(void);
 extern void lcd_task_init(void);
 extern void alarm_task_init(void);
+extern void stats_task_init(void);
 /*-----------------------------------------------------------*/
 
 int main( void )
@@ -91,6 +92,7 @@ int main( void )
     time_task_init();
     lcd_task_init();
     alarm_task_init();
+    stats_task_init();
 
     /* Start the scheduler.  This should not return. */
     vTaskStartScheduler();
@@ -34,6 +34,9 @@
 //*****************************************************************************
 #define ETHERNET_INT_PRIORITY   0xC0
 #define GPIO_PK_INT_PRIORITY    0xA0
+#define HIBERNATE_INT_PRIORITY  0xA0
+#define DEBOUNCE_INT_PRIORITY   0xA0
+#define I2C0_INT_PRIORITY       0xA0
 
 //*****************************************************************************
 //
@@ -46,6 +49,7 @@
 #define PRIORITY_TIME_TASK      4
 #define PRIORITY_LCD_TASK       5
 #define PRIORITY_ALARM_TASK     6
+#define PRIORITY_STATS_TASK     1
 #define PRIORITY_ETH_INT_TASK   1
 #define PRIORITY_TCPIP_TASK     3
 
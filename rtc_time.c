@@ -0,0 +1,290 @@
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "inc/hw_types.h"
+#include "inc/hw_memmap.h"
+
+#include "driverlib/hibernate.h"
+#include "driverlib/sw_crc.h"
+
+#include "rtc_time.h"
+
+// nominal value of the RTC pre-divider trim, each count away from it changes the length
+// of one second in every 64 by 1/32768 s, which is 2^-21 or about 0.48 ppm
+#define RTC_TRIM_NOMINAL 0x7fff
+#define RTC_TRIM_RATE_SHIFT 21
+#define RTC_TRIM_MAX_CORRECTION 0x4000
+
+// offsets larger than this, plus the resolution of the sample, are stepped instead of slewed through the trim
+#define RTC_STEP_THRESHOLD_SUBSECONDS (RTC_SUBSECONDS_PER_SECOND / 2)
+
+// new frequency measurements are weighted 1/RTC_FREQ_GAIN into the running estimate
+#define RTC_FREQ_GAIN 4
+
+// samples closer together than this are too short a baseline to measure the drift over
+#define RTC_FREQ_MIN_INTERVAL_SUBSECONDS ((int64_t)RTC_SYNC_INTERVAL_SECONDS / 2 * RTC_SUBSECONDS_PER_SECOND)
+
+// a coarse sample only places the time within its resolution, so the drift is measured over at least
+// 2^17 times the resolution, for the 1 s of the http Date header about 36 hours and at most 7.6 ppm off
+#define RTC_FREQ_RESOLUTION_SHIFT 17
+
+#define RTC_FRACTION_SHIFT 17
+
+// the discipline state is checkpointed into the battery-backed memory of the hibernation module
+// after every change of the trim, so that after a reset the RTC, which kept counting, is trusted right away
+#define RTC_CHECKPOINT_MAGIC 0x52544332
+#define RTC_CHECKPOINT_WORDS (sizeof(rtc_checkpoint_t) / sizeof(uint32_t))
+
+// times are in 1/32768 s, the frequency is measured from the anchor sample to the latest one
+// with the trim that was applied in between integrated over time, since the phase correction
+// of every sample only stays in the trim until slew_end
+typedef struct rtc_discipline_t{
+    uint64_t anchor;
+    int64_t anchor_offset;
+    int64_t trim_sum;
+    uint64_t trim_since;
+    uint32_t slew_end;
+    int32_t freq;
+    int32_t trim;
+    bool freq_valid;
+    volatile bool valid;
+}rtc_discipline_t;
+
+// 64 bit values are split so the checkpoint is a plain array of words
+typedef struct rtc_checkpoint_t{
+    uint32_t magic;
+    uint32_t anchor_low;
+    uint32_t anchor_high;
+    uint32_t anchor_offset_low;
+    uint32_t anchor_offset_high;
+    uint32_t trim_sum_low;
+    uint32_t trim_sum_high;
+    uint32_t trim_since_low;
+    uint32_t trim_since_high;
+    uint32_t slew_end;
+    int32_t freq;
+    int32_t trim;
+    uint32_t freq_valid;
+    uint32_t crc;
+}rtc_checkpoint_t;
+
+extern uint32_t g_ui32SysClock;
+
+static rtc_discipline_t l_rtc;
+
+// current RTC time in 1/32768 s
+static uint64_t rtc_time_subseconds(void){
+    uint32_t seconds;
+    uint32_t subseconds;
+    rtc_time_get(&seconds, &subseconds);
+    return ((uint64_t)seconds << 15) | subseconds;
+}
+
+// limits a trim or frequency value to what the trim register can correct
+static int32_t rtc_trim_clamp(int64_t trim){
+    if(trim > RTC_TRIM_MAX_CORRECTION){
+        return RTC_TRIM_MAX_CORRECTION;
+    }
+    if(trim < -RTC_TRIM_MAX_CORRECTION){
+        return -RTC_TRIM_MAX_CORRECTION;
+    }
+    return (int32_t)trim;
+}
+
+// accumulates the trim applied since the last change, weighted by how long it was applied
+static void rtc_trim_integrate(uint64_t now){
+    l_rtc.trim_sum += (int64_t)l_rtc.trim * (int64_t)(now - l_rtc.trim_since);
+    l_rtc.trim_since = now;
+}
+
+static void rtc_trim_set(int32_t trim, uint64_t now){
+    rtc_trim_integrate(now);
+    l_rtc.trim = rtc_trim_clamp(trim);
+    HibernateRTCTrimSet(RTC_TRIM_NOMINAL + l_rtc.trim);
+}
+
+// covers every word of the checkpoint but the crc itself
+static uint32_t rtc_checkpoint_crc(const rtc_checkpoint_t *checkpoint){
+    return Crc32(0xffffffff, (const uint8_t*)checkpoint, sizeof(rtc_checkpoint_t) - sizeof(uint32_t));
+}
+
+static uint64_t rtc_checkpoint_join(uint32_t low, uint32_t high){
+    return ((uint64_t)high << 32) | low;
+}
+
+static void rtc_checkpoint_save(void){
+    rtc_checkpoint_t checkpoint;
+    checkpoint.magic = RTC_CHECKPOINT_MAGIC;
+    checkpoint.anchor_low = (uint32_t)l_rtc.anchor;
+    checkpoint.anchor_high = (uint32_t)(l_rtc.anchor >> 32);
+    checkpoint.anchor_offset_low = (uint32_t)l_rtc.anchor_offset;
+    checkpoint.anchor_offset_high = (uint32_t)((uint64_t)l_rtc.anchor_offset >> 32);
+    checkpoint.trim_sum_low = (uint32_t)l_rtc.trim_sum;
+    checkpoint.trim_sum_high = (uint32_t)((uint64_t)l_rtc.trim_sum >> 32);
+    checkpoint.trim_since_low = (uint32_t)l_rtc.trim_since;
+    checkpoint.trim_since_high = (uint32_t)(l_rtc.trim_since >> 32);
+    checkpoint.slew_end = l_rtc.slew_end;
+    checkpoint.freq = l_rtc.freq;
+    checkpoint.trim = l_rtc.trim;
+    checkpoint.freq_valid = l_rtc.freq_valid;
+    checkpoint.crc = rtc_checkpoint_crc(&checkpoint);
+    HibernateDataSet((uint32_t*)&checkpoint, RTC_CHECKPOINT_WORDS);
+}
+
+// takes the discipline state over from the checkpoint, returns false if there is none to trust
+static bool rtc_checkpoint_restore(void){
+    rtc_checkpoint_t checkpoint;
+    HibernateDataGet((uint32_t*)&checkpoint, RTC_CHECKPOINT_WORDS);
+    if(checkpoint.magic != RTC_CHECKPOINT_MAGIC || checkpoint.crc != rtc_checkpoint_crc(&checkpoint)){
+        return false;
+    }
+
+    // a counter behind the last change of the trim was restarted, e.g. because the battery ran out
+    uint64_t now = rtc_time_subseconds();
+    uint64_t trim_since = rtc_checkpoint_join(checkpoint.trim_since_low, checkpoint.trim_since_high);
+    if(now < trim_since){
+        return false;
+    }
+
+    l_rtc.anchor = rtc_checkpoint_join(checkpoint.anchor_low, checkpoint.anchor_high);
+    l_rtc.anchor_offset = (int64_t)rtc_checkpoint_join(checkpoint.anchor_offset_low, checkpoint.anchor_offset_high);
+    l_rtc.trim_sum = (int64_t)rtc_checkpoint_join(checkpoint.trim_sum_low, checkpoint.trim_sum_high);
+    l_rtc.trim_since = trim_since;
+    l_rtc.slew_end = checkpoint.slew_end;
+    l_rtc.freq = rtc_trim_clamp(checkpoint.freq);
+    l_rtc.freq_valid = checkpoint.freq_valid != 0;
+    l_rtc.trim = rtc_trim_clamp(checkpoint.trim);
+    l_rtc.valid = true;
+
+    // the trim register kept the checkpointed trim through the reset, and a phase correction
+    // that ran out meanwhile ends now
+    rtc_trim_set(l_rtc.trim, now);
+    rtc_time_tick();
+    return true;
+}
+
+// starts the RTC from the 32.768 kHz crystal, the time is invalid until the first sample
+// if the hibernation module stayed powered through the reset, the RTC kept counting and is left running,
+// and with a valid checkpoint the time is valid right away, the next sample only refines it
+void rtc_time_init(void){
+    HibernateEnableExpClk(g_ui32SysClock);
+
+    l_rtc.freq = 0;
+    l_rtc.trim = 0;
+    l_rtc.trim_sum = 0;
+    l_rtc.trim_since = 0;
+    l_rtc.freq_valid = false;
+    l_rtc.valid = false;
+
+    if(HibernateIsActive() && rtc_checkpoint_restore()){
+        return;
+    }
+
+    HibernateClockConfig(HIBERNATE_OSC_LOWDRIVE);
+    HibernateCounterMode(HIBERNATE_COUNTER_RTC);
+    HibernateRTCEnable();
+    HibernateRTCTrimSet(RTC_TRIM_NOMINAL);
+}
+
+bool rtc_time_valid(void){
+    return l_rtc.valid;
+}
+
+// reads seconds and subseconds, retrying if the seconds rolled over in between
+void rtc_time_get(uint32_t *seconds, uint32_t *subseconds){
+    uint32_t s;
+    do{
+        s = HibernateRTCGet();
+        *subseconds = HibernateRTCSSGet();
+    }while(s != HibernateRTCGet());
+    *seconds = s;
+}
+
+// removes an offset by trimming the RTC rate away from the crystal error for one sync interval,
+// only the part of the offset beyond the resolution of the sample is certain, so only that is corrected
+static void rtc_slew(int64_t offset, uint32_t resolution, uint64_t now){
+    int64_t deadband = resolution / 2;
+    int64_t phase = 0;
+    if(offset > deadband){
+        phase = offset - deadband;
+    }
+    else if(offset < -deadband){
+        phase = offset + deadband;
+    }
+
+    // run faster than the crystal error alone would require by enough to catch up the offset
+    rtc_trim_set(l_rtc.freq - (int32_t)(phase * 64 / RTC_SYNC_INTERVAL_SECONDS), now);
+    l_rtc.slew_end = (uint32_t)(now >> 15) + RTC_SYNC_INTERVAL_SECONDS;
+}
+
+// disciplines the RTC with a network time sample in unix seconds plus a 2^-32 second fraction,
+// which is only known to within resolution 1/32768 s, e.g. a whole second for the http Date header
+// small offsets are slewed away, and the drift from the anchor sample to this one keeps the trim
+// centered on the crystal error in between
+// must only be called from one task, the same one that calls rtc_time_tick
+void rtc_time_sample(uint32_t seconds, uint32_t fraction, uint32_t resolution){
+
+    uint64_t server = ((uint64_t)seconds << 15) | (fraction >> RTC_FRACTION_SHIFT);
+    uint64_t now = rtc_time_subseconds();
+    int64_t offset = (int64_t)(server - now);
+    int64_t threshold = RTC_STEP_THRESHOLD_SUBSECONDS + (int64_t)resolution;
+
+    if(!l_rtc.valid || offset > threshold || offset < -threshold){
+        // loading the RTC restarts the current second, so round to the nearest one
+        // and carry the remaining fraction as the offset to slew away
+        bool round_up = (fraction >> 31) != 0;
+        HibernateRTCSet(seconds + round_up);
+        now = (uint64_t)(seconds + round_up) << 15;
+
+        // the time scale changed, so the drift is measured afresh from here
+        l_rtc.anchor = server;
+        l_rtc.anchor_offset = (int64_t)(server - now);
+        l_rtc.trim_sum = 0;
+        l_rtc.trim_since = now;
+        // an error this large means the frequency estimate can't be trusted either, the next measurement replaces it
+        l_rtc.freq_valid = false;
+        l_rtc.valid = true;
+        rtc_slew(l_rtc.anchor_offset, resolution, now);
+        rtc_checkpoint_save();
+        return;
+    }
+
+    // drift rate since the anchor in trim counts, plus the mean trim that was applied meanwhile
+    rtc_trim_integrate(now);
+    int64_t interval = (int64_t)(server - l_rtc.anchor);
+    if(interval >= RTC_FREQ_MIN_INTERVAL_SUBSECONDS && interval >= (int64_t)resolution << RTC_FREQ_RESOLUTION_SHIFT){
+        int32_t measured = rtc_trim_clamp(((l_rtc.anchor_offset - offset) * ((int64_t)1 << RTC_TRIM_RATE_SHIFT) +
+                                           l_rtc.trim_sum) / interval);
+        if(l_rtc.freq_valid){
+            l_rtc.freq = rtc_trim_clamp(l_rtc.freq + (measured - l_rtc.freq) / RTC_FREQ_GAIN);
+        }
+        else{
+            l_rtc.freq = measured;
+            l_rtc.freq_valid = true;
+        }
+
+        l_rtc.anchor = server;
+        l_rtc.anchor_offset = offset;
+        l_rtc.trim_sum = 0;
+    }
+
+    rtc_slew(offset, resolution, now);
+    rtc_checkpoint_save();
+}
+
+// ends the phase correction of the last sample once its sync interval is over and leaves the RTC
+// running at the measured crystal error, so that without samples it doesn't keep pulling away
+// called by time_task at least once per minute
+void rtc_time_tick(void){
+    if(!l_rtc.valid || l_rtc.trim == l_rtc.freq){
+        return;
+    }
+
+    uint32_t seconds;
+    uint32_t subseconds;
+    rtc_time_get(&seconds, &subseconds);
+    if((int32_t)(seconds - l_rtc.slew_end) >= 0){
+        rtc_trim_set(l_rtc.freq, ((uint64_t)seconds << 15) | subseconds);
+        rtc_checkpoint_save();
+    }
+}
@@ -0,0 +1,19 @@
+#ifndef RTC_TIME_H
+#define RTC_TIME_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// the hibernate RTC counts 32768 subseconds per second
+#define RTC_SUBSECONDS_PER_SECOND 32768
+
+// expected time between network samples, used to spread phase corrections over one interval
+#define RTC_SYNC_INTERVAL_SECONDS 3600
+
+void rtc_time_init(void);
+bool rtc_time_valid(void);
+void rtc_time_get(uint32_t *seconds, uint32_t *subseconds);
+void rtc_time_sample(uint32_t seconds, uint32_t fraction, uint32_t resolution);
+void rtc_time_tick(void);
+
+#endif
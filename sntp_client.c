@@ -0,0 +1,241 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "utils/lwiplib.h"
+
+#include "lwip/udp.h"
+#include "lwip/pbuf.h"
+#include "lwip/tcpip.h"
+#include "lwip/timers.h"
+
+#include "sntp_client.h"
+
+#define SNTP_PORT 123
+#define SNTP_MSG_LEN 48
+
+// LI = 0, VN = 4, Mode = 3 (client)
+#define SNTP_LI_VN_MODE_CLIENT 0x23
+#define SNTP_MODE_MASK 0x07
+#define SNTP_MODE_SERVER 0x04
+#define SNTP_LI_MASK 0xc0
+#define SNTP_LI_ALARM 0xc0
+
+#define SNTP_OFFSET_STRATUM 1
+#define SNTP_OFFSET_REFERENCE_ID 12
+#define SNTP_OFFSET_ORIGINATE 24
+#define SNTP_OFFSET_RECEIVE 32
+#define SNTP_OFFSET_TRANSMIT 40
+
+// a stratum 0 reply is a kiss-o'-death with an ASCII kiss code in the reference id
+// DENY and RSTR mean the server refuses this client, any other code asks it to poll less often
+#define SNTP_KISS_DENY 0x44454e59
+#define SNTP_KISS_RSTR 0x52535452
+
+// seconds between the NTP epoch (1900) and the unix epoch (1970)
+#define SNTP_UNIX_EPOCH_OFFSET 2208988800UL
+
+// after a failed poll the retry interval starts at the minimum and doubles up to the poll interval
+#ifndef SNTP_RETRY_MIN_MILLISECONDS
+#define SNTP_RETRY_MIN_MILLISECONDS 1000
+#endif
+
+#define SNTP_RESPONSE_TIMEOUT_MILLISECONDS 1000
+
+// samples whose round trip took longer than this are too uncertain to use
+#define SNTP_MAX_DELAY_MILLISECONDS 500
+
+typedef struct sntp_state_t{
+    struct udp_pcb *pcb;
+    ip_addr_t server;
+    sntp_sample_fn sample_fn;
+    uint32_t poll_ms;
+    uint32_t retry_ms;
+    uint32_t tx_ticks;
+    uint32_t tx_cookie;
+    bool waiting;
+}sntp_state_t;
+
+static sntp_state_t l_sntp;
+
+static void sntp_poll(void *arg);
+static void sntp_stop_cb(void *ctx);
+
+// reads a big endian 64 bit NTP timestamp out of the packet
+static uint64_t sntp_get_timestamp(struct pbuf *p, uint16_t offset){
+    uint8_t buf[8];
+    pbuf_copy_partial(p, buf, sizeof(buf), offset);
+
+    uint64_t ts = 0;
+    uint8_t i;
+    for(i = 0; i != sizeof(buf); ++i){
+        ts = (ts << 8) | buf[i];
+    }
+    return ts;
+}
+
+// reads a big endian 32 bit word out of the packet
+static uint32_t sntp_get_word(struct pbuf *p, uint16_t offset){
+    uint32_t word = 0;
+    uint8_t i;
+    for(i = 0; i != 4; ++i){
+        word = (word << 8) | pbuf_get_at(p, offset + i);
+    }
+    return word;
+}
+
+// arms the single lwIP timeout used for both the next poll and the response timeout
+static void sntp_schedule(uint32_t ms){
+    sys_untimeout(sntp_poll, NULL);
+    sys_timeout(ms, sntp_poll, NULL);
+}
+
+static void sntp_failed(void){
+    l_sntp.waiting = false;
+    sntp_schedule((l_sntp.retry_ms < l_sntp.poll_ms)? l_sntp.retry_ms: l_sntp.poll_ms);
+    if(l_sntp.retry_ms < l_sntp.poll_ms){
+        l_sntp.retry_ms *= 2;
+    }
+}
+
+// a kissed client must not retry any sooner than its poll interval, and stops for good when refused
+static void sntp_kissed(uint32_t code){
+    if(code == SNTP_KISS_DENY || code == SNTP_KISS_RSTR){
+        sntp_stop_cb(NULL);
+        return;
+    }
+    l_sntp.waiting = false;
+    l_sntp.retry_ms = l_sntp.poll_ms;
+    sntp_schedule(l_sntp.poll_ms);
+}
+
+static void sntp_recv(void *arg, struct udp_pcb *pcb, struct pbuf *p, ip_addr_t *addr, u16_t port){
+
+    uint32_t rx_ticks = xTaskGetTickCount();
+
+    if(!l_sntp.waiting || !ip_addr_cmp(addr, &l_sntp.server) || port != SNTP_PORT || p->tot_len < SNTP_MSG_LEN){
+        pbuf_free(p);
+        return;
+    }
+
+    uint8_t li_vn_mode = pbuf_get_at(p, 0);
+    uint8_t stratum = pbuf_get_at(p, SNTP_OFFSET_STRATUM);
+    uint32_t reference_id = sntp_get_word(p, SNTP_OFFSET_REFERENCE_ID);
+    uint64_t originate = sntp_get_timestamp(p, SNTP_OFFSET_ORIGINATE);
+    uint64_t receive = sntp_get_timestamp(p, SNTP_OFFSET_RECEIVE);
+    uint64_t transmit = sntp_get_timestamp(p, SNTP_OFFSET_TRANSMIT);
+    pbuf_free(p);
+
+    // the server echoes our transmit timestamp, anything else is a stale or forged reply
+    if((uint32_t)originate != l_sntp.tx_cookie){
+        return;
+    }
+
+    if((li_vn_mode & SNTP_MODE_MASK) == SNTP_MODE_SERVER && stratum == 0){
+        sntp_kissed(reference_id);
+        return;
+    }
+
+    if((li_vn_mode & SNTP_MODE_MASK) != SNTP_MODE_SERVER || (li_vn_mode & SNTP_LI_MASK) == SNTP_LI_ALARM ||
+       stratum > 15 || transmit == 0){
+        sntp_failed();
+        return;
+    }
+
+    // round trip delay = (T4 - T1) - (T3 - T2), local times are in ticks
+    uint64_t rtt = ((uint64_t)((rx_ticks - l_sntp.tx_ticks) * portTICK_PERIOD_MS) << 32) / 1000;
+    uint64_t server_hold = transmit - receive;
+    uint64_t delay = (rtt > server_hold)? rtt - server_hold: 0;
+
+    if(delay > ((uint64_t)SNTP_MAX_DELAY_MILLISECONDS << 32) / 1000){
+        sntp_failed();
+        return;
+    }
+
+    // the reply left the server at T3 and took about half the round trip to get here
+    uint64_t now = transmit + delay / 2;
+
+    l_sntp.waiting = false;
+    l_sntp.retry_ms = SNTP_RETRY_MIN_MILLISECONDS;
+    sntp_schedule(l_sntp.poll_ms);
+
+    if(l_sntp.sample_fn != NULL){
+        l_sntp.sample_fn((uint32_t)(now >> 32) - SNTP_UNIX_EPOCH_OFFSET, (uint32_t)now);
+    }
+}
+
+// sends one request, or handles the response timeout if the last request is still unanswered
+static void sntp_poll(void *arg){
+
+    if(l_sntp.waiting){
+        sntp_failed();
+        return;
+    }
+
+    struct pbuf *p = pbuf_alloc(PBUF_TRANSPORT, SNTP_MSG_LEN, PBUF_RAM);
+    if(p == NULL){
+        sntp_failed();
+        return;
+    }
+
+    uint8_t *msg = (uint8_t*)p->payload;
+    memset(msg, 0, SNTP_MSG_LEN);
+    msg[0] = SNTP_LI_VN_MODE_CLIENT;
+
+    // the transmit timestamp only has to be unique, the server copies it into the originate field
+    l_sntp.tx_ticks = xTaskGetTickCount();
+    l_sntp.tx_cookie = l_sntp.tx_cookie * 1664525 + 1013904223 + l_sntp.tx_ticks;
+    msg[SNTP_OFFSET_TRANSMIT + 4] = (uint8_t)(l_sntp.tx_cookie >> 24);
+    msg[SNTP_OFFSET_TRANSMIT + 5] = (uint8_t)(l_sntp.tx_cookie >> 16);
+    msg[SNTP_OFFSET_TRANSMIT + 6] = (uint8_t)(l_sntp.tx_cookie >> 8);
+    msg[SNTP_OFFSET_TRANSMIT + 7] = (uint8_t)l_sntp.tx_cookie;
+
+    err_t err = udp_sendto(l_sntp.pcb, p, &l_sntp.server, SNTP_PORT);
+    pbuf_free(p);
+
+    if(err != ERR_OK){
+        sntp_failed();
+        return;
+    }
+
+    l_sntp.waiting = true;
+    sntp_schedule(SNTP_RESPONSE_TIMEOUT_MILLISECONDS);
+}
+
+static void sntp_start_cb(void *ctx){
+    if(l_sntp.pcb == NULL){
+        l_sntp.pcb = udp_new();
+        if(l_sntp.pcb == NULL){
+            return;
+        }
+        udp_recv(l_sntp.pcb, sntp_recv, NULL);
+    }
+    l_sntp.waiting = false;
+    l_sntp.retry_ms = SNTP_RETRY_MIN_MILLISECONDS;
+    sntp_schedule(0);
+}
+
+static void sntp_stop_cb(void *ctx){
+    sys_untimeout(sntp_poll, NULL);
+    if(l_sntp.pcb != NULL){
+        udp_remove(l_sntp.pcb);
+        l_sntp.pcb = NULL;
+    }
+    l_sntp.waiting = false;
+}
+
+// starts polling the server every poll_ms, sample_fn is called from the tcpip thread for every good response
+// polling stops on its own if the server refuses the client with a DENY or RSTR kiss-o'-death
+void sntp_client_start(const ip_addr_t *server, uint32_t poll_ms, sntp_sample_fn sample_fn){
+    l_sntp.server = *server;
+    l_sntp.poll_ms = poll_ms;
+    l_sntp.sample_fn = sample_fn;
+    tcpip_callback(sntp_start_cb, NULL);
+}
+
+void sntp_client_stop(void){
+    tcpip_callback(sntp_stop_cb, NULL);
+}
@@ -0,0 +1,15 @@
+#ifndef SNTP_CLIENT_H
+#define SNTP_CLIENT_H
+
+#include <stdint.h>
+
+#include "lwip/ip_addr.h"
+
+// called from the tcpip thread with the current UTC time in unix seconds plus a
+// 2^-32 second fraction, already compensated for half of the round trip delay
+typedef void (*sntp_sample_fn)(uint32_t seconds, uint32_t fraction);
+
+void sntp_client_start(const ip_addr_t *server, uint32_t poll_ms, sntp_sample_fn sample_fn);
+void sntp_client_stop(void);
+
+#endif
@@ -38,7 +38,7 @@
  * @defgroup httpc HTTP client
  * @ingroup apps
  * @todo:
- * - persistent connections
+ * - persistent connections for GET (HEAD is supported via httpc_keepalive_open)
  * - select outgoing http version
  * - optionally follow redirect
  * - check request uri for invalid characters? (e.g. encode spaces)
@@ -124,6 +124,26 @@
     "\r\n"
 #define HTTPC_REQ_11_PROXY_PORT_FORMAT(host, host_port, uri, srv_name) (HTTPC_REQ_11_PROXY_PORT), host, host_port, uri, (HTTPC_CLIENT_AGENT), srv_name
 
+/* HEAD request with host on a persistent connection */
+#define HTTPC_REQ_11_HEAD_KEEPALIVE "HEAD %s HTTP/1.1\r\n" /* URI */\
+    "User-Agent: %s\r\n" /* User-Agent */ \
+    "Accept: */*\r\n" \
+    "Host: %s\r\n" /* server name */ \
+    "Connection: keep-alive\r\n" \
+    "\r\n"
+#define HTTPC_REQ_11_HEAD_KEEPALIVE_FORMAT(uri, srv_name) (HTTPC_REQ_11_HEAD_KEEPALIVE), uri, (HTTPC_CLIENT_AGENT), srv_name
+
+/** Maximum number of HEAD requests in flight on one persistent connection */
+#ifndef HTTPC_KEEPALIVE_MAX_PENDING
+#define HTTPC_KEEPALIVE_MAX_PENDING 4
+#endif
+
+/** Poll intervals a persistent connection may stay idle before it is closed,
+ * so a half-open connection cannot hold its pcb until the next request times out */
+#ifndef HTTPC_KEEPALIVE_IDLE_TIMEOUT
+#define HTTPC_KEEPALIVE_IDLE_TIMEOUT 120 /* 60 seconds */
+#endif
+
 typedef enum ehttpc_parse_state {
   HTTPC_PARSE_WAIT_FIRST_LINE = 0,
   HTTPC_PARSE_WAIT_HEADERS,
@@ -136,6 +156,7 @@ struct _httpc_state
   ip_addr_t remote_addr;
   u16_t remote_port;
   int timeout_ticks;
+  int idle_ticks;
   struct pbuf *request;
   struct pbuf *rx_hdrs;
   u16_t rx_http_version;
@@ -146,6 +167,14 @@ struct _httpc_state
   u32_t rx_content_len;
   u32_t hdr_content_len;
   httpc_parse_state_t parse_state;
+  u8_t keepalive;
+  u8_t connected;
+  u8_t pending;
+  httpc_header_line_fn header_line_fn;
+  /* header scanner: offsets into rx_hdrs of the next unscanned byte and of the current line */
+  u16_t hdr_scan_off;
+  u16_t hdr_line_off;
+  u8_t hdr_skip;
 #if HTTPC_DEBUG_REQUEST
   char* server_name;
   char* uri;
@@ -243,36 +272,89 @@ http_parse_response_status(struct pbuf *p, u16_t *http_version, u16_t *http_stat
   return ERR_VAL;
 }
 
-/** Wait for all headers to be received, return its length and content-length (if available) */
+/** Scan the header bytes received since the last call line by line.
+ * Every byte is looked at once, so long headers arriving in many segments cost linear time.
+ * Parses the status line and Content-Length and passes every line to header_line_fn.
+ * Lines already scanned in skip mode are freed (and acknowledged) right away.
+ * @return ERR_OK with the header length once the empty line was found,
+ *         ERR_INPROGRESS if more data is needed, any other error to close the connection
+ */
 static err_t
-http_wait_headers(struct pbuf *p, u32_t *content_length, u16_t *total_header_len)
+httpc_scan_headers(httpc_state_t *req, struct altcp_pcb *pcb, u16_t *total_header_len)
 {
-  u16_t end1 = pbuf_memfind(p, "\r\n\r\n", 4, 0);
-  if (end1 < (0xFFFF - 2)) {
-    /* all headers received */
-    /* check if we have a content length (@todo: case insensitive?) */
-    u16_t content_len_hdr;
-    *content_length = HTTPC_CONTENT_LEN_INVALID;
-    *total_header_len = end1 + 4;
-
-    content_len_hdr = pbuf_memfind(p, "Content-Length: ", 16, 0);
-    if (content_len_hdr != 0xFFFF) {
-      u16_t content_len_line_end = pbuf_memfind(p, "\r\n", 2, content_len_hdr);
-      if (content_len_line_end != 0xFFFF) {
-        char content_len_num[16];
-        u16_t content_len_num_len = (u16_t)(content_len_line_end - content_len_hdr - 16);
-        memset(content_len_num, 0, sizeof(content_len_num));
-        if (pbuf_copy_partial(p, content_len_num, content_len_num_len, content_len_hdr + 16) == content_len_num_len) {
-          int len = atoi(content_len_num);
-          if ((len >= 0) && ((u32_t)len < HTTPC_CONTENT_LEN_INVALID)) {
-            *content_length = (u32_t)len;
+  struct pbuf *q;
+  u16_t pos = 0;
+  char prev = 0;
+
+  if (req->hdr_scan_off > 0) {
+    prev = (char)pbuf_get_at(req->rx_hdrs, req->hdr_scan_off - 1);
+  }
+  for (q = req->rx_hdrs; q != NULL; pos += q->len, q = q->next) {
+    u16_t i;
+    if ((u16_t)(pos + q->len) <= req->hdr_scan_off) {
+      continue;
+    }
+    for (i = req->hdr_scan_off - pos; i < q->len; i++) {
+      char c = ((const char*)q->payload)[i];
+      u16_t line_len;
+      req->hdr_scan_off++;
+      if (c != '\n') {
+        prev = c;
+        continue;
+      }
+      line_len = req->hdr_scan_off - 1 - req->hdr_line_off - ((prev == '\r') ? 1 : 0);
+      prev = c;
+      if (line_len == 0) {
+        /* empty line: end of the header block */
+        *total_header_len = req->hdr_scan_off;
+        req->hdr_scan_off = 0;
+        req->hdr_line_off = 0;
+        return ERR_OK;
+      }
+      if (req->parse_state == HTTPC_PARSE_WAIT_FIRST_LINE) {
+        u16_t status_str_off;
+        if (http_parse_response_status(req->rx_hdrs, &req->rx_http_version, &req->rx_status, &status_str_off) != ERR_OK) {
+          return ERR_VAL;
+        }
+        /* don't care status string */
+        req->parse_state = HTTPC_PARSE_WAIT_HEADERS;
+        req->hdr_content_len = HTTPC_CONTENT_LEN_INVALID;
+      } else if (!req->hdr_skip) {
+        /* check if we have a content length (@todo: case insensitive?) */
+        if ((line_len > 16) && (line_len < 16 + 16) &&
+            (pbuf_memcmp(req->rx_hdrs, req->hdr_line_off, "Content-Length: ", 16) == 0)) {
+          char content_len_num[16];
+          memset(content_len_num, 0, sizeof(content_len_num));
+          if (pbuf_copy_partial(req->rx_hdrs, content_len_num, line_len - 16, req->hdr_line_off + 16) == line_len - 16) {
+            int len = atoi(content_len_num);
+            if ((len >= 0) && ((u32_t)len < HTTPC_CONTENT_LEN_INVALID)) {
+              req->hdr_content_len = (u32_t)len;
+            }
+          }
+        }
+        if (req->header_line_fn != NULL) {
+          err_t err = req->header_line_fn(req->callback_arg, req->rx_hdrs, req->hdr_line_off, line_len);
+          if (err != ERR_OK) {
+            if (!req->keepalive) {
+              return err;
+            }
+            /* keep the connection, but stop buffering this header */
+            req->hdr_skip = 1;
           }
         }
       }
+      req->hdr_line_off = req->hdr_scan_off;
     }
-    return ERR_OK;
   }
-  return ERR_VAL;
+  if (req->hdr_skip && (req->hdr_line_off > 0)) {
+    /* nobody needs the complete lines any more: free them and open the receive window */
+    u16_t done = req->hdr_line_off;
+    req->rx_hdrs = pbuf_free_header(req->rx_hdrs, done);
+    altcp_recved(pcb, done);
+    req->hdr_scan_off -= done;
+    req->hdr_line_off = 0;
+  }
+  return ERR_INPROGRESS;
 }
 
 /** http client tcp recv callback */
@@ -298,41 +380,35 @@ httpc_tcp_recv(void *arg, struct altcp_pcb *pcb, struct pbuf *p, err_t r)
     return httpc_close(req, result, req->rx_status, ERR_OK);
   }
   if (req->parse_state != HTTPC_PARSE_RX_DATA) {
+    u16_t total_header_len;
+    err_t err;
     if (req->rx_hdrs == NULL) {
       req->rx_hdrs = p;
     } else {
       pbuf_cat(req->rx_hdrs, p);
     }
-    if (req->parse_state == HTTPC_PARSE_WAIT_FIRST_LINE) {
-      u16_t status_str_off;
-      err_t err = http_parse_response_status(req->rx_hdrs, &req->rx_http_version, &req->rx_status, &status_str_off);
-      if (err == ERR_OK) {
-        /* don't care status string */
-        req->parse_state = HTTPC_PARSE_WAIT_HEADERS;
-      }
+    err = httpc_scan_headers(req, pcb, &total_header_len);
+    if ((err != ERR_OK) && (err != ERR_INPROGRESS)) {
+      return httpc_close(req, HTTPC_RESULT_LOCAL_ABORT, req->rx_status, err);
     }
-    if (req->parse_state == HTTPC_PARSE_WAIT_HEADERS) {
-      u16_t total_header_len;
-      err_t err = http_wait_headers(req->rx_hdrs, &req->hdr_content_len, &total_header_len);
-      if (err == ERR_OK) {
-        struct pbuf *q;
-        /* full header received, send window update for header bytes and call into client callback */
-        altcp_recved(pcb, total_header_len);
-        if (req->conn_settings) {
-          if (req->conn_settings->headers_done_fn) {
-            err = req->conn_settings->headers_done_fn(req, req->callback_arg, req->rx_hdrs, total_header_len, req->hdr_content_len);
-            if (err != ERR_OK) {
-              return httpc_close(req, HTTPC_RESULT_LOCAL_ABORT, req->rx_status, err);
-            }
+    if (err == ERR_OK) {
+      struct pbuf *q;
+      /* full header received, send window update for header bytes and call into client callback */
+      altcp_recved(pcb, total_header_len);
+      if (req->conn_settings) {
+        if (req->conn_settings->headers_done_fn) {
+          err = req->conn_settings->headers_done_fn(req, req->callback_arg, req->rx_hdrs, total_header_len, req->hdr_content_len);
+          if (err != ERR_OK) {
+            return httpc_close(req, HTTPC_RESULT_LOCAL_ABORT, req->rx_status, err);
           }
         }
-        /* hide header bytes in pbuf */
-        q = pbuf_free_header(req->rx_hdrs, total_header_len);
-        p = q;
-        req->rx_hdrs = NULL;
-        /* go on with data */
-        req->parse_state = HTTPC_PARSE_RX_DATA;
       }
+      /* hide header bytes in pbuf */
+      q = pbuf_free_header(req->rx_hdrs, total_header_len);
+      p = q;
+      req->rx_hdrs = NULL;
+      /* go on with data */
+      req->parse_state = HTTPC_PARSE_RX_DATA;
     }
   }
   if ((p != NULL) && (req->parse_state == HTTPC_PARSE_RX_DATA)) {
@@ -350,6 +426,64 @@ httpc_tcp_recv(void *arg, struct altcp_pcb *pcb, struct pbuf *p, err_t r)
   return ERR_OK;
 }
 
+/** http client tcp recv callback for persistent connections:
+ * HEAD responses carry no body, so every complete header block finishes one
+ * pipelined request and the remaining bytes start the next response.
+ */
+static err_t
+httpc_keepalive_tcp_recv(void *arg, struct altcp_pcb *pcb, struct pbuf *p, err_t r)
+{
+  httpc_state_t* req = (httpc_state_t*)arg;
+  LWIP_UNUSED_ARG(r);
+
+  if (p == NULL) {
+    /* server closed the persistent connection */
+    return httpc_close(req, HTTPC_RESULT_ERR_CLOSED, req->rx_status, ERR_OK);
+  }
+  if (req->rx_hdrs == NULL) {
+    req->rx_hdrs = p;
+  } else {
+    pbuf_cat(req->rx_hdrs, p);
+  }
+  while (req->rx_hdrs != NULL) {
+    u16_t total_header_len;
+    err_t err = httpc_scan_headers(req, pcb, &total_header_len);
+    if (err == ERR_INPROGRESS) {
+      break;
+    }
+    if (err != ERR_OK) {
+      /* not an http response: the stream is out of sync */
+      return httpc_close(req, HTTPC_RESULT_ERR_UNKNOWN, req->rx_status, err);
+    }
+    if (req->pending == 0) {
+      /* response without a request: the stream is out of sync */
+      return httpc_close(req, HTTPC_RESULT_ERR_UNKNOWN, req->rx_status, ERR_VAL);
+    }
+    req->pending--;
+    req->timeout_ticks = HTTPC_POLL_TIMEOUT;
+    req->idle_ticks = HTTPC_KEEPALIVE_IDLE_TIMEOUT;
+    altcp_recved(pcb, total_header_len);
+    if (req->conn_settings && !req->hdr_skip) {
+      if (req->conn_settings->headers_done_fn) {
+        err = req->conn_settings->headers_done_fn(req, req->callback_arg, req->rx_hdrs, total_header_len, req->hdr_content_len);
+        if (err != ERR_OK) {
+          return httpc_close(req, HTTPC_RESULT_LOCAL_ABORT, req->rx_status, err);
+        }
+      }
+    }
+    req->hdr_skip = 0;
+    /* drop this header block, anything left belongs to the next response */
+    req->rx_hdrs = pbuf_free_header(req->rx_hdrs, total_header_len);
+    req->parse_state = HTTPC_PARSE_WAIT_FIRST_LINE;
+    if (req->conn_settings) {
+      if (req->conn_settings->result_fn) {
+        req->conn_settings->result_fn(req->callback_arg, HTTPC_RESULT_OK, 0, req->rx_status, ERR_OK);
+      }
+    }
+  }
+  return ERR_OK;
+}
+
 /** http client tcp err callback */
 static void
 httpc_tcp_err(void *arg, err_t err)
@@ -370,6 +504,17 @@ httpc_tcp_poll(void *arg, struct altcp_pcb *pcb)
   httpc_state_t* req = (httpc_state_t*)arg;
   LWIP_UNUSED_ARG(pcb);
   if (req != NULL) {
+    if (req->keepalive && (req->pending == 0)) {
+      /* an idle persistent connection only times out after the longer idle timeout */
+      req->timeout_ticks = HTTPC_POLL_TIMEOUT;
+      if (req->idle_ticks) {
+        req->idle_ticks--;
+      }
+      if (!req->idle_ticks) {
+        return httpc_close(req, HTTPC_RESULT_ERR_TIMEOUT, 0, ERR_OK);
+      }
+      return ERR_OK;
+    }
     if (req->timeout_ticks) {
       req->timeout_ticks--;
     }
@@ -406,9 +551,15 @@ httpc_tcp_connected(void *arg, struct altcp_pcb *pcb, err_t err)
      /* could not write the single small request -> fail, don't retry */
      return httpc_close(req, HTTPC_RESULT_ERR_MEM, 0, r);
   }
-  /* everything written, we can free the request */
-  pbuf_free(req->request);
-  req->request = NULL;
+  if (req->keepalive) {
+    /* keep the formatted request around to resend it on this connection */
+    req->connected = 1;
+    req->pending++;
+  } else {
+    /* everything written, we can free the request */
+    pbuf_free(req->request);
+    req->request = NULL;
+  }
 
   altcp_output(req->pcb);
   return ERR_OK;
@@ -487,9 +638,12 @@ httpc_get_internal_dns(httpc_state_t* req, const char* server_name)
 
 static int
 httpc_create_request_string(const httpc_connection_t *settings, const char* server_name, int server_port, const char* uri,
-                            int use_host, char *buffer, size_t buffer_size)
+                            int use_host, int keepalive, char *buffer, size_t buffer_size)
 {
-  if (settings->use_proxy) {
+  if (keepalive) {
+    LWIP_ASSERT("server_name != NULL", server_name != NULL);
+    return snprintf(buffer, buffer_size, HTTPC_REQ_11_HEAD_KEEPALIVE_FORMAT(uri, server_name));
+  } else if (settings->use_proxy) {
     LWIP_ASSERT("server_name != NULL", server_name != NULL);
     if (server_port != HTTP_DEFAULT_PORT) {
       return snprintf(buffer, buffer_size, HTTPC_REQ_11_PROXY_PORT_FORMAT(server_name, server_port, uri, server_name));
@@ -507,7 +661,8 @@ httpc_create_request_string(const httpc_connection_t *settings, const char* serv
 /** Initialize the connection struct */
 static err_t
 httpc_init_connection_common(httpc_state_t **connection, const httpc_connection_t *settings, const char* server_name,
-                      u16_t server_port, const char* uri, altcp_recv_fn recv_fn, void* callback_arg, int use_host)
+                      u16_t server_port, const char* uri, altcp_recv_fn recv_fn, void* callback_arg, int use_host,
+                      int keepalive)
 {
   size_t alloc_len;
   mem_size_t mem_alloc_len;
@@ -520,7 +675,7 @@ httpc_init_connection_common(httpc_state_t **connection, const httpc_connection_
   LWIP_ASSERT("uri != NULL", uri != NULL);
 
   /* get request len */
-  req_len = httpc_create_request_string(settings, server_name, server_port, uri, use_host, NULL, 0);
+  req_len = httpc_create_request_string(settings, server_name, server_port, uri, use_host, keepalive, NULL, 0);
   if ((req_len < 0) || (req_len > 0xFFFF)) {
     return ERR_VAL;
   }
@@ -542,6 +697,7 @@ httpc_init_connection_common(httpc_state_t **connection, const httpc_connection_
   }
   memset(req, 0, sizeof(httpc_state_t));
   req->timeout_ticks = HTTPC_POLL_TIMEOUT;
+  req->idle_ticks = HTTPC_KEEPALIVE_IDLE_TIMEOUT;
   req->request = pbuf_alloc(PBUF_RAW, (u16_t)(req_len + 1), PBUF_RAM);
   if (req->request == NULL) {
     httpc_free_state(req);
@@ -567,14 +723,15 @@ httpc_init_connection_common(httpc_state_t **connection, const httpc_connection_
     return ERR_MEM;
   }
   req->remote_port = settings->use_proxy ? settings->proxy_port : server_port;
+  req->keepalive = (u8_t)(keepalive != 0);
   altcp_arg(req->pcb, req);
-  altcp_recv(req->pcb, httpc_tcp_recv);
+  altcp_recv(req->pcb, keepalive ? httpc_keepalive_tcp_recv : httpc_tcp_recv);
   altcp_err(req->pcb, httpc_tcp_err);
   altcp_poll(req->pcb, httpc_tcp_poll, HTTPC_POLL_INTERVAL);
   altcp_sent(req->pcb, httpc_tcp_sent);
 
   /* set up request buffer */
-  req_len2 = httpc_create_request_string(settings, server_name, server_port, uri, use_host,
+  req_len2 = httpc_create_request_string(settings, server_name, server_port, uri, use_host, keepalive,
     (char *)req->request->payload, req_len + 1);
   if (req_len2 != req_len) {
     httpc_free_state(req);
@@ -596,7 +753,7 @@ static err_t
 httpc_init_connection(httpc_state_t **connection, const httpc_connection_t *settings, const char* server_name,
                       u16_t server_port, const char* uri, altcp_recv_fn recv_fn, void* callback_arg)
 {
-  return httpc_init_connection_common(connection, settings, server_name, server_port, uri, recv_fn, callback_arg, 1);
+  return httpc_init_connection_common(connection, settings, server_name, server_port, uri, recv_fn, callback_arg, 1, 0);
 }
 
 
@@ -606,14 +763,14 @@ httpc_init_connection(httpc_state_t **connection, const httpc_connection_t *sett
 static err_t
 httpc_init_connection_addr(httpc_state_t **connection, const httpc_connection_t *settings,
                            const ip_addr_t* server_addr, u16_t server_port, const char* uri,
-                           altcp_recv_fn recv_fn, void* callback_arg)
+                           altcp_recv_fn recv_fn, void* callback_arg, int keepalive)
 {
   char *server_addr_str = ipaddr_ntoa(server_addr);
   if (server_addr_str == NULL) {
     return ERR_VAL;
   }
   return httpc_init_connection_common(connection, settings, server_addr_str, server_port, uri,
-    recv_fn, callback_arg, 1);
+    recv_fn, callback_arg, 1, keepalive);
 }
 
 /**
@@ -640,7 +797,7 @@ httpc_get_file(const ip_addr_t* server_addr, u16_t port, const char* uri, const
   LWIP_ERROR("invalid parameters", (server_addr != NULL) && (uri != NULL) && (recv_fn != NULL), return ERR_ARG;);
 
   err = httpc_init_connection_addr(&req, settings, server_addr, port,
-    uri, recv_fn, callback_arg);
+    uri, recv_fn, callback_arg, 0);
   if (err != ERR_OK) {
     return err;
   }
@@ -705,6 +862,115 @@ httpc_get_file_dns(const char* server_name, u16_t port, const char* uri, const h
   return ERR_OK;
 }
 
+/**
+ * @ingroup httpc
+ * HTTP client API: open a persistent connection and send a first HEAD request
+ *
+ * Every response calls headers_done_fn followed by result_fn with
+ * HTTPC_RESULT_OK while the connection stays open. A connection without
+ * requests in flight is closed after HTTPC_KEEPALIVE_IDLE_TIMEOUT. Any other result passed to
+ * result_fn means the connection has been closed and the handle is invalid.
+ *
+ * @param server_addr IP address of the server to connect
+ * @param port tcp port of the server
+ * @param uri uri to request from the server, remember leading "/"!
+ * @param settings connection settings (callbacks only, proxies are not supported)
+ * @param callback_arg argument passed to all the callbacks
+ * @param connection retreives the connection handle for httpc_keepalive_head
+ * @return ERR_OK if starting the connection succeeds or an error code
+ */
+err_t
+httpc_keepalive_open(const ip_addr_t* server_addr, u16_t port, const char* uri, const httpc_connection_t *settings,
+                     void* callback_arg, httpc_state_t **connection)
+{
+  err_t err;
+  httpc_state_t* req;
+
+  LWIP_ERROR("invalid parameters", (server_addr != NULL) && (uri != NULL) && (settings != NULL) &&
+    !settings->use_proxy && (connection != NULL), return ERR_ARG;);
+
+  err = httpc_init_connection_addr(&req, settings, server_addr, port,
+    uri, NULL, callback_arg, 1);
+  if (err != ERR_OK) {
+    return err;
+  }
+
+  err = httpc_get_internal_addr(req, server_addr);
+  if(err != ERR_OK) {
+    httpc_free_state(req);
+    return err;
+  }
+
+  *connection = req;
+  return ERR_OK;
+}
+
+/**
+ * @ingroup httpc
+ * HTTP client API: pipeline another HEAD request on a persistent connection
+ *
+ * The request string formatted by httpc_keepalive_open is reused, so this
+ * does not allocate or format anything.
+ *
+ * @param connection handle returned by httpc_keepalive_open
+ * @return ERR_OK if the request was queued, ERR_CONN if the connection is not
+ *         established yet, ERR_INPROGRESS if too many requests are in flight
+ *         or an error code from altcp_write
+ */
+err_t
+httpc_keepalive_head(httpc_state_t *connection)
+{
+  err_t r;
+
+  LWIP_ERROR("invalid parameters", (connection != NULL) && connection->keepalive, return ERR_ARG;);
+
+  if (!connection->connected) {
+    return ERR_CONN;
+  }
+  if (connection->pending >= HTTPC_KEEPALIVE_MAX_PENDING) {
+    return ERR_INPROGRESS;
+  }
+  r = altcp_write(connection->pcb, connection->request->payload, connection->request->len - 1, TCP_WRITE_FLAG_COPY);
+  if (r != ERR_OK) {
+    return r;
+  }
+  connection->pending++;
+  altcp_output(connection->pcb);
+  return ERR_OK;
+}
+
+/**
+ * @ingroup httpc
+ * HTTP client API: set a callback that gets every response header line as soon
+ * as it is complete, before the rest of the header block has been received
+ *
+ * @param connection handle returned by httpc_get_file or httpc_keepalive_open
+ * @param header_line_fn callback, or NULL to remove it
+ */
+void
+httpc_set_header_line_fn(httpc_state_t *connection, httpc_header_line_fn header_line_fn)
+{
+  LWIP_ERROR("invalid parameters", connection != NULL, return;);
+
+  connection->header_line_fn = header_line_fn;
+}
+
+/**
+ * @ingroup httpc
+ * HTTP client API: close a persistent connection
+ *
+ * result_fn is called with HTTPC_RESULT_LOCAL_ABORT before the handle is freed.
+ *
+ * @param connection handle returned by httpc_keepalive_open
+ */
+void
+httpc_keepalive_close(httpc_state_t *connection)
+{
+  if (connection != NULL) {
+    httpc_close(connection, HTTPC_RESULT_LOCAL_ABORT, connection->rx_status, ERR_OK);
+  }
+}
+
 #if LWIP_HTTPC_HAVE_FILE_IO
 /* Implementation to disk via fopen/fwrite/fclose follows */
 
@@ -832,7 +1098,7 @@ httpc_get_file_to_disk(const ip_addr_t* server_addr, u16_t port, const char* uri
   }
 
   err = httpc_init_connection_addr(&req, &filestate->settings, server_addr, port,
-    uri, httpc_fs_tcp_recv, filestate);
+    uri, httpc_fs_tcp_recv, filestate, 0);
   if (err != ERR_OK) {
     httpc_fs_free(filestate);
     return err;
@@ -200,9 +200,11 @@ extern void lwIPHostTimerHandler(void);
 #include "inc/hw_memmap.h"
 #include "inc/hw_nvic.h"
 #include "driverlib/debug.h"
+#include "driverlib/eeprom.h"
 #include "driverlib/emac.h"
 #include "driverlib/rom.h"
 #include "driverlib/rom_map.h"
+#include "driverlib/sw_crc.h"
 #include "driverlib/sysctl.h"
 #if !NO_SYS
 #if RTOS_FREERTOS
@@ -349,6 +351,39 @@ static uint32_t g_ui32IPMode = IPADDR_USE_STATIC;
 static bool g_bLinkActive = false;
 #endif
 
+//*****************************************************************************
+//
+// The last DHCP lease, cached in the EEPROM.  After a reset or a link up the
+// cached address is requested right away (the INIT-REBOOT state of RFC 2131)
+// instead of going through a full discover cycle first.  The server either
+// acknowledges the address or rejects it, in which case DHCP falls back to a
+// normal discover, so the cache never needs to expire on its own.  The
+// addresses are kept in network byte order.
+//
+//*****************************************************************************
+#if LWIP_DHCP
+#ifndef DHCP_CACHE_EEPROM_ADDR
+#define DHCP_CACHE_EEPROM_ADDR  0
+#endif
+#define DHCP_CACHE_MAGIC        0x44484350
+
+typedef struct
+{
+    uint32_t ui32Magic;
+    uint32_t ui32IPAddr;
+    uint32_t ui32NetMask;
+    uint32_t ui32GWAddr;
+    uint32_t ui32ServerAddr;
+    uint32_t ui32LeaseSeconds;
+    uint32_t ui32CRC;
+}
+tDHCPCache;
+
+static tDHCPCache g_sDHCPCache;
+static bool g_bDHCPCacheValid = false;
+static bool g_bEEPROMReady = false;
+#endif
+
 //*****************************************************************************
 //
 // The IP address to be used.  This is used during the initialization of the
@@ -384,12 +419,37 @@ static uint32_t g_ui32GWAddr;
 
 //*****************************************************************************
 //
-// The handle for the "queue" (semaphore) used to signal the interrupt task
-// from the interrupt handler.
+// The Ethernet interrupts that are serviced by the interrupt task.  They stay
+// disabled from the interrupt until the task has handled them.
+//
+//*****************************************************************************
+#if !NO_SYS
+#define ETH_TASK_INTS           (EMAC_INT_RECEIVE | EMAC_INT_TRANSMIT |       \
+                                 EMAC_INT_TX_STOPPED |                        \
+                                 EMAC_INT_RX_NO_BUFFER |                      \
+                                 EMAC_INT_RX_STOPPED | EMAC_INT_PHY)
+#endif
+
+//*****************************************************************************
+//
+// The handle of the interrupt task.  The interrupt handler ORs the interrupt
+// status into the task's notification value, so any number of interrupts
+// that arrive before the task runs are serviced by a single pass.
+//
+//*****************************************************************************
+#if !NO_SYS
+static xTaskHandle g_pInterruptTask;
+#endif
+
+//*****************************************************************************
+//
+// The number of Ethernet interrupts handed to the interrupt task, and the
+// number of passes the task needed to service them.
 //
 //*****************************************************************************
 #if !NO_SYS
-static xQueueHandle g_pInterrupt;
+static volatile uint32_t g_ui32IntCount;
+static uint32_t g_ui32IntTaskPasses;
 #endif
 
 //*****************************************************************************
@@ -402,31 +462,126 @@ static xQueueHandle g_pInterrupt;
 static void
 lwIPInterruptTask(void *pvArg)
 {
+    uint32_t ui32Status;
+
     //
     // Loop forever.
     //
     while(1)
     {
         //
-        // Wait until the semaphore has been signaled.
+        // Wait until the interrupt handler has posted some status, taking
+        // every bit that was posted since the last pass.
         //
-        while(xQueueReceive(g_pInterrupt, &pvArg, portMAX_DELAY) != pdPASS)
+        while(xTaskNotifyWait(0, 0xffffffff, &ui32Status, portMAX_DELAY) !=
+              pdPASS)
         {
         }
 
+        g_ui32IntTaskPasses++;
+
         //
-        // Processes any packets waiting to be sent or received.
+        // Processes any packets waiting to be sent or received.  This drains
+        // every descriptor that is ready, not only the one that raised the
+        // interrupt.
         //
-        tivaif_interrupt(&g_sNetIF, (uint32_t)pvArg);
+        tivaif_interrupt(&g_sNetIF, ui32Status);
 
         //
-        // Re-enable the Ethernet interrupts.
+        // Re-enable the Ethernet interrupts.  Anything that completed while
+        // they were disabled is still latched and interrupts right away.
         //
-        MAP_EMACIntEnable(EMAC0_BASE, (EMAC_INT_RECEIVE | EMAC_INT_TRANSMIT |
-                                       EMAC_INT_TX_STOPPED |
-                                       EMAC_INT_RX_NO_BUFFER |
-                                       EMAC_INT_RX_STOPPED | EMAC_INT_PHY));
+        MAP_EMACIntEnable(EMAC0_BASE, ETH_TASK_INTS);
+    }
+}
+#endif
+
+//*****************************************************************************
+//
+// Computes the CRC of a cached DHCP lease, covering every field but the CRC.
+//
+//*****************************************************************************
+#if LWIP_DHCP
+static uint32_t
+lwIPDHCPCacheCRC(const tDHCPCache *psCache)
+{
+    return(Crc32(0xffffffff, (const uint8_t *)psCache,
+                 sizeof(tDHCPCache) - sizeof(uint32_t)));
+}
+#endif
+
+//*****************************************************************************
+//
+// Reads the cached DHCP lease from the EEPROM.  The cache is only used if its
+// magic number and CRC are intact.
+//
+//*****************************************************************************
+#if LWIP_DHCP
+static void
+lwIPDHCPCacheLoad(void)
+{
+    MAP_SysCtlPeripheralEnable(SYSCTL_PERIPH_EEPROM0);
+    while(!MAP_SysCtlPeripheralReady(SYSCTL_PERIPH_EEPROM0))
+    {
     }
+
+    g_bEEPROMReady = (EEPROMInit() == EEPROM_INIT_OK);
+    if(!g_bEEPROMReady)
+    {
+        return;
+    }
+
+    EEPROMRead((uint32_t *)&g_sDHCPCache, DHCP_CACHE_EEPROM_ADDR,
+               sizeof(g_sDHCPCache));
+    g_bDHCPCacheValid = ((g_sDHCPCache.ui32Magic == DHCP_CACHE_MAGIC) &&
+                         (g_sDHCPCache.ui32CRC ==
+                          lwIPDHCPCacheCRC(&g_sDHCPCache)) &&
+                         (g_sDHCPCache.ui32IPAddr != 0));
+}
+#endif
+
+//*****************************************************************************
+//
+// Writes the current DHCP lease to the EEPROM once DHCP is bound.  Renewals
+// of the same lease are not written again, to spare the EEPROM.
+//
+//*****************************************************************************
+#if LWIP_DHCP
+static void
+lwIPDHCPCacheSave(void)
+{
+    struct dhcp *psDHCP;
+
+    psDHCP = g_sNetIF.dhcp;
+    if(!g_bEEPROMReady || (psDHCP == NULL) || (psDHCP->state != DHCP_BOUND))
+    {
+        return;
+    }
+
+    if(g_bDHCPCacheValid &&
+       (g_sDHCPCache.ui32IPAddr ==
+        ip4_addr_get_u32(&psDHCP->offered_ip_addr)) &&
+       (g_sDHCPCache.ui32NetMask ==
+        ip4_addr_get_u32(&psDHCP->offered_sn_mask)) &&
+       (g_sDHCPCache.ui32GWAddr ==
+        ip4_addr_get_u32(&psDHCP->offered_gw_addr)) &&
+       (g_sDHCPCache.ui32ServerAddr ==
+        ip4_addr_get_u32(&psDHCP->server_ip_addr)))
+    {
+        return;
+    }
+
+    g_sDHCPCache.ui32Magic = DHCP_CACHE_MAGIC;
+    g_sDHCPCache.ui32IPAddr = ip4_addr_get_u32(&psDHCP->offered_ip_addr);
+    g_sDHCPCache.ui32NetMask = ip4_addr_get_u32(&psDHCP->offered_sn_mask);
+    g_sDHCPCache.ui32GWAddr = ip4_addr_get_u32(&psDHCP->offered_gw_addr);
+    g_sDHCPCache.ui32ServerAddr = ip4_addr_get_u32(&psDHCP->server_ip_addr);
+    g_sDHCPCache.ui32LeaseSeconds = psDHCP->offered_t0_lease;
+    g_sDHCPCache.ui32CRC = lwIPDHCPCacheCRC(&g_sDHCPCache);
+
+    g_bDHCPCacheValid = (EEPROMProgram((uint32_t *)&g_sDHCPCache,
+                                       DHCP_CACHE_EEPROM_ADDR,
+                                       sizeof(g_sDHCPCache)) == 0);
 }
 #endif
 
@@ -445,6 +600,16 @@ lwIPLinkDetect(void)
     struct ip_addr net_mask;
     struct ip_addr gw_addr;
 
+    //
+    // Keep the cached DHCP lease up to date.
+    //
+#if LWIP_DHCP
+    if(g_ui32IPMode == IPADDR_USE_DHCP)
+    {
+        lwIPDHCPCacheSave();
+    }
+#endif
+
     //
     // See if there is an active link.
     //
@@ -484,6 +649,18 @@ lwIPLinkDetect(void)
         if(g_ui32IPMode == IPADDR_USE_DHCP)
         {
             dhcp_start(&g_sNetIF);
+
+            //
+            // If a lease is cached, ask for its address again right away.
+            // An offer for the discover sent by dhcp_start is ignored once
+            // DHCP is rebooting.
+            //
+            if(g_bDHCPCacheValid && (g_sNetIF.dhcp != NULL))
+            {
+                ip4_addr_set_u32(&g_sNetIF.dhcp->offered_ip_addr,
+                                 g_sDHCPCache.ui32IPAddr);
+                dhcp_reboot(&g_sNetIF);
+            }
         }
 #endif
 
@@ -710,23 +887,14 @@ lwIPPrivateInit(void *pvArg)
 #endif
 
     //
-    // If using a RTOS, create a queue (to be used as a semaphore) to signal
-    // the Ethernet interrupt task from the Ethernet interrupt handler.
-    //
-#if !NO_SYS
-#if RTOS_FREERTOS
-    g_pInterrupt = xQueueCreate(1, sizeof(void *));
-#endif
-#endif
-
-    //
-    // If using a RTOS, create the Ethernet interrupt task.
+    // If using a RTOS, create the Ethernet interrupt task.  The Ethernet
+    // interrupt handler signals it through its task notification.
     //
 #if !NO_SYS
 #if RTOS_FREERTOS
     xTaskCreate(lwIPInterruptTask, (signed portCHAR *)"eth_int",
                 STACKSIZE_LWIPINTTASK, 0, tskIDLE_PRIORITY + 1,
-                0);
+                &g_pInterruptTask);
 #endif
 #endif
 
@@ -865,6 +1033,16 @@ lwIPInit(uint32_t ui32SysClkHz, const uint8_t *pui8MAC, uint32_t ui32IPAddr,
     {
     }
 
+    //
+    // Read the cached DHCP lease, if DHCP is used.
+    //
+#if LWIP_DHCP
+    if(ui32IPMode == IPADDR_USE_DHCP)
+    {
+        lwIPDHCPCacheLoad();
+    }
+#endif
+
     //
     // Configure for use with whichever PHY the user requires.
     //
@@ -878,7 +1056,10 @@ lwIPInit(uint32_t ui32SysClkHz, const uint8_t *pui8MAC, uint32_t ui32IPAddr,
                  4, 4, 0);
 
     //
-    // Set MAC configuration options.
+    // Set MAC configuration options.  Frames with TCP/IP checksum errors are
+    // dropped by the MAC, unless the checksums are being verified in software
+    // (see CHECKSUM_OFFLOAD_VERIFY in lwipopts.h), in which case they are
+    // passed on for lwIP to check and count.
     //
     MAP_EMACConfigSet(EMAC0_BASE, (EMAC_CONFIG_FULL_DUPLEX |
                                    EMAC_CONFIG_CHECKSUM_OFFLOAD |
@@ -890,6 +1071,9 @@ lwIPInit(uint32_t ui32SysClkHz, const uint8_t *pui8MAC, uint32_t ui32IPAddr,
                       (EMAC_MODE_RX_STORE_FORWARD |
                        EMAC_MODE_TX_STORE_FORWARD |
                        EMAC_MODE_TX_THRESHOLD_64_BYTES |
+#if CHECKSUM_OFFLOAD_VERIFY
+                       EMAC_MODE_KEEP_BAD_CRC |
+#endif
                        EMAC_MODE_RX_THRESHOLD_64_BYTES), 0);
 
     //
@@ -1086,19 +1270,20 @@ lwIPEthernetIntHandler(void)
     lwIPServiceTimers();
 #else
     //
-    // A RTOS is being used.  Signal the Ethernet interrupt task.
+    // A RTOS is being used.  Signal the Ethernet interrupt task by merging
+    // the status into its notification value, so no status is lost if the
+    // task has not run since the last interrupt.
     //
-    xQueueSendFromISR(g_pInterrupt, (void *)&ui32Status, &xWake);
+    xWake = pdFALSE;
+    g_ui32IntCount++;
+    xTaskNotifyFromISR(g_pInterruptTask, ui32Status, eSetBits, &xWake);
 
     //
     // Disable the Ethernet interrupts.  Since the interrupts have not been
     // handled, they are not asserted.  Once they are handled by the Ethernet
     // interrupt task, it will re-enable the interrupts.
     //
-    MAP_EMACIntDisable(EMAC0_BASE, (EMAC_INT_RECEIVE | EMAC_INT_TRANSMIT |
-                                    EMAC_INT_TX_STOPPED |
-                                    EMAC_INT_RX_NO_BUFFER |
-                                    EMAC_INT_RX_STOPPED | EMAC_INT_PHY));
+    MAP_EMACIntDisable(EMAC0_BASE, ETH_TASK_INTS);
 
     //
     // Potentially task switch as a result of the above queue write.
@@ -0,0 +1,167 @@
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "inc/hw_memmap.h"
+#include "inc/hw_types.h"
+
+#include "driverlib/sw_crc.h"
+#include "driverlib/timer.h"
+#include "driverlib/uart.h"
+
+#include "stats.h"
+#include "priorities.h"
+
+#define STATS_TASK_SIZE_WORDS 100
+
+#define STATS_INTERVAL_MILLISECONDS 5000
+#define STATS_BAUD_RATE 115200
+
+// tasks that fit into one snapshot, the others are left out
+#define STATS_MAX_TASKS 10
+
+// a snapshot goes out as one frame, all fields little endian:
+//  sync 0xa5 0x5a, payload length (2 bytes), payload, CRC-16 of the payload (2 bytes)
+// the payload is
+//  version (1), task count (1), tick count (4), run time counter (4), free heap (4), lowest free heap (4),
+//  sleep count (4), run time counter spent asleep (4)
+// followed by one record per task
+//  task number (1), state (1), priority (1), name (configMAX_TASK_NAME_LEN), run time (4), stack high water mark in words (2)
+#define STATS_VERSION 2
+#define STATS_SYNC_0 0xa5
+#define STATS_SYNC_1 0x5a
+#define STATS_HEADER_LEN 26
+#define STATS_TASK_LEN (9 + configMAX_TASK_NAME_LEN)
+#define STATS_FRAME_MAX (4 + STATS_HEADER_LEN + STATS_MAX_TASKS * STATS_TASK_LEN + 2)
+
+extern uint32_t g_ui32SysClock;
+
+static TaskStatus_t l_task_status[STATS_MAX_TASKS];
+static uint8_t l_frame[STATS_FRAME_MAX];
+
+// heap_2 has no minimum ever free heap size, so the lowest value seen by a snapshot is kept instead
+static size_t l_heap_low;
+
+// sleeps of the tickless idle and the run time counter spent in them, both wrap around
+static uint32_t l_sleep_count;
+static uint32_t l_sleep_time;
+static uint32_t l_sleep_start;
+
+// the run time counter is a free running 32 bit timer at the system clock,
+// it wraps every 429 seconds at 10 MHz, so only differences between snapshots are meaningful
+void stats_timer_init(void){
+    TimerConfigure(TIMER1_BASE, TIMER_CFG_PERIODIC_UP);
+    TimerLoadSet(TIMER1_BASE, TIMER_A, 0xffffffff);
+    TimerEnable(TIMER1_BASE, TIMER_A);
+}
+
+uint32_t stats_timer_value(void){
+    return TimerValueGet(TIMER1_BASE, TIMER_A);
+}
+
+// the timer keeps counting in sleep mode, so the time asleep is the difference across the wfi
+void stats_sleep_enter(void){
+    l_sleep_start = stats_timer_value();
+}
+
+void stats_sleep_exit(void){
+    l_sleep_time += stats_timer_value() - l_sleep_start;
+    ++l_sleep_count;
+}
+
+static uint8_t *stats_put_16(uint8_t *buf, uint16_t value){
+    buf[0] = value;
+    buf[1] = value >> 8;
+    return buf + 2;
+}
+
+static uint8_t *stats_put_32(uint8_t *buf, uint32_t value){
+    buf[0] = value;
+    buf[1] = value >> 8;
+    buf[2] = value >> 16;
+    buf[3] = value >> 24;
+    return buf + 4;
+}
+
+// fills l_frame with a snapshot of every task and returns its length
+static uint16_t stats_snapshot(void){
+
+    uint32_t run_time;
+    UBaseType_t count = uxTaskGetSystemState(l_task_status, STATS_MAX_TASKS, &run_time);
+
+    size_t heap_free = xPortGetFreeHeapSize();
+    if(heap_free < l_heap_low){
+        l_heap_low = heap_free;
+    }
+
+    uint8_t *buf = l_frame + 4;
+    *buf++ = STATS_VERSION;
+    *buf++ = count;
+    buf = stats_put_32(buf, xTaskGetTickCount());
+    buf = stats_put_32(buf, stats_timer_value());
+    buf = stats_put_32(buf, heap_free);
+    buf = stats_put_32(buf, l_heap_low);
+    buf = stats_put_32(buf, l_sleep_count);
+    buf = stats_put_32(buf, l_sleep_time);
+
+    UBaseType_t task;
+    for(task = 0; task != count; ++task){
+        TaskStatus_t *status = &l_task_status[task];
+        *buf++ = status->xTaskNumber;
+        *buf++ = status->eCurrentState;
+        *buf++ = status->uxCurrentPriority;
+
+        // names shorter than configMAX_TASK_NAME_LEN are padded with zeros
+        uint8_t i;
+        bool end = false;
+        for(i = 0; i != configMAX_TASK_NAME_LEN; ++i){
+            end = end || status->pcTaskName[i] == '\0';
+            *buf++ = end? '\0': status->pcTaskName[i];
+        }
+
+        buf = stats_put_32(buf, status->ulRunTimeCounter);
+        buf = stats_put_16(buf, status->usStackHighWaterMark);
+    }
+
+    uint16_t payload_len = buf - (l_frame + 4);
+    l_frame[0] = STATS_SYNC_0;
+    l_frame[1] = STATS_SYNC_1;
+    stats_put_16(l_frame + 2, payload_len);
+    buf = stats_put_16(buf, Crc16(0, l_frame + 4, payload_len));
+
+    return buf - l_frame;
+}
+
+// sends a snapshot of the run time, stack and heap usage of every task over UART0 at a fixed interval
+// the UART FIFO is filled without blocking and the task sleeps while it drains, so the idle task still runs
+void stats_task(void *args){
+
+    TickType_t last_wake = xTaskGetTickCount();
+    while(1){
+        vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(STATS_INTERVAL_MILLISECONDS));
+
+        uint16_t len = stats_snapshot();
+        uint16_t sent = 0;
+        while(sent != len){
+            if(UARTCharPutNonBlocking(UART0_BASE, l_frame[sent])){
+                ++sent;
+            }
+            else{
+                vTaskDelay(1);
+            }
+        }
+    }
+}
+
+// create the stats task
+void inline stats_task_init(void){
+    l_heap_low = xPortGetFreeHeapSize();
+
+    UARTConfigSetExpClk(UART0_BASE, g_ui32SysClock, STATS_BAUD_RATE, UART_CONFIG_WLEN_8 | UART_CONFIG_STOP_ONE | UART_CONFIG_PAR_NONE);
+    UARTFIFOEnable(UART0_BASE);
+    UARTEnable(UART0_BASE);
+
+    xTaskCreate(stats_task, "stats_task", STATS_TASK_SIZE_WORDS, NULL, PRIORITY_STATS_TASK, NULL);
+}
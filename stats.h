@@ -0,0 +1,14 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdint.h>
+
+// run time counter for the FreeRTOS run time stats, see FreeRTOSConfig.h
+void stats_timer_init(void);
+uint32_t stats_timer_value(void);
+
+// called by the tickless idle around every sleep, with interrupts disabled
+void stats_sleep_enter(void);
+void stats_sleep_exit(void);
+
+#endif
@@ -0,0 +1,22 @@
+#ifndef STUB_HIBERNATE_H
+#define STUB_HIBERNATE_H
+
+#include <stdint.h>
+
+// the driverlib calls rtc_time.c makes, simulated by test_rtc_time.c
+#define HIBERNATE_OSC_LOWDRIVE 0x00060000
+#define HIBERNATE_COUNTER_RTC 0x00000040
+
+void HibernateEnableExpClk(uint32_t ui32HibClk);
+uint32_t HibernateIsActive(void);
+void HibernateClockConfig(uint32_t ui32Config);
+void HibernateCounterMode(uint32_t ui32Config);
+void HibernateRTCEnable(void);
+void HibernateRTCSet(uint32_t ui32RTCValue);
+uint32_t HibernateRTCGet(void);
+uint32_t HibernateRTCSSGet(void);
+void HibernateRTCTrimSet(uint32_t ui32Trim);
+void HibernateDataSet(uint32_t *pui32Data, uint32_t ui32Count);
+void HibernateDataGet(uint32_t *pui32Data, uint32_t ui32Count);
+
+#endif
@@ -0,0 +1,13 @@
+#ifndef STUB_SW_CRC_H
+#define STUB_SW_CRC_H
+
+#include <stdint.h>
+
+// the TivaWare prototypes, the implementation is linked from src/tiva_drivers/sw_crc.c
+uint8_t Crc8CCITT(uint8_t ui8Crc, const uint8_t *pui8Data, uint32_t ui32Count);
+uint16_t Crc16(uint16_t ui16Crc, const uint8_t *pui8Data, uint32_t ui32Count);
+uint16_t Crc16Array(uint32_t ui32WordLen, const uint32_t *pui32Data);
+void Crc16Array3(uint32_t ui32WordLen, const uint32_t *pui32Data, uint16_t *pui16Crc3);
+uint32_t Crc32(uint32_t ui32Crc, const uint8_t *pui8Data, uint32_t ui32Count);
+
+#endif
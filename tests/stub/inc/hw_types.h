@@ -0,0 +1 @@
+// rtc_time.c needs nothing from the TivaWare register headers on the host
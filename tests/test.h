@@ -0,0 +1,25 @@
+#ifndef TEST_H
+#define TEST_H
+
+#include <stdio.h>
+
+// minimal host test harness, every check that fails is reported and the test exits non-zero
+static unsigned l_test_checks;
+static unsigned l_test_failures;
+
+#define CHECK(cond) do{ \
+    ++l_test_checks; \
+    if(!(cond)){ \
+        ++l_test_failures; \
+        if(l_test_failures <= 20){ \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+        } \
+    } \
+}while(0)
+
+static inline int test_result(const char *name){
+    printf("%s: %u checks, %u failed\n", name, l_test_checks, l_test_failures);
+    return l_test_failures != 0;
+}
+
+#endif
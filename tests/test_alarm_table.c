@@ -0,0 +1,215 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdlib.h>
+#include <time.h>
+
+#include "test.h"
+
+// white box, the heap arrays are checked directly
+#include "../alarm_table.c"
+
+// 2024-03-01 00:00:00 UTC, a few days before the US switch to dst
+#define TEST_START 1709251200u
+
+static uint32_t l_rand_state = 1;
+
+static uint32_t test_rand(void){
+    l_rand_state = l_rand_state * 1103515245u + 12345u;
+    return l_rand_state >> 8;
+}
+
+// the heap order, the position index and the slot flags all have to agree
+static void check_heap(void){
+    uint8_t pos;
+    uint8_t used = 0;
+    uint8_t id;
+
+    for(id = 0; id != ALARM_TABLE_SIZE; ++id){
+        used += l_alarms[id].in_use;
+    }
+    CHECK(used == l_heap_size);
+
+    for(pos = 0; pos != l_heap_size; ++pos){
+        id = l_heap[pos];
+        CHECK(id < ALARM_TABLE_SIZE);
+        CHECK(l_alarms[id].in_use);
+        CHECK(l_heap_pos[id] == pos);
+        CHECK(l_alarms[id].armed || l_alarms[id].next_fire == UINT32_MAX);
+        if(pos != 0){
+            CHECK(l_alarms[l_heap[(pos - 1) / 2]].next_fire <= l_alarms[id].next_fire);
+        }
+    }
+}
+
+// the first due alarm found by a linear scan, UINT32_MAX if none is armed
+static uint32_t scan_next(void){
+    uint32_t fire = UINT32_MAX;
+    uint8_t id;
+    for(id = 0; id != ALARM_TABLE_SIZE; ++id){
+        if(l_alarms[id].in_use && l_alarms[id].armed && l_alarms[id].next_fire < fire){
+            fire = l_alarms[id].next_fire;
+        }
+    }
+    return fire;
+}
+
+// an armed alarm fires after now, at its local hour:minute on one of its weekdays,
+// unless that time was skipped by the spring dst change
+static void check_fire(uint8_t id, uint32_t now){
+    const alarm_entry_t *alarm = &l_alarms[id];
+    if(!alarm->armed){
+        return;
+    }
+    CHECK(alarm->next_fire > now);
+    CHECK(alarm->next_fire - now <= 8 * SECONDS_PER_DAY);
+
+    time_t fire = alarm->next_fire;
+    struct tm local;
+    localtime_r(&fire, &local);
+    if(local.tm_hour != alarm->hour || local.tm_min != alarm->minute){
+        // a skipped local time fires the same number of seconds into the new offset
+        CHECK(local.tm_isdst && local.tm_hour == alarm->hour + 1 && local.tm_min == alarm->minute);
+    }
+    CHECK(alarm->weekdays == ALARM_ONCE || (alarm->weekdays & (1 << local.tm_wday)));
+}
+
+static void test_random(uint8_t zone){
+    uint32_t now = TEST_START;
+    uint32_t step;
+    uint8_t ids[ALARM_TABLE_SIZE];
+    uint8_t count = 0;
+
+    tz_select(zone);
+    setenv("TZ", tz_zone(zone)->posix, 1);
+    tzset();
+    alarm_table_init();
+
+    for(step = 0; step != 20000; ++step){
+        uint32_t op = test_rand() % 7;
+        uint8_t hour = test_rand() % 24;
+        uint8_t minute = test_rand() % 60;
+        uint8_t weekdays = (test_rand() % 3 == 0)? ALARM_ONCE: test_rand() % 0x80;
+        uint8_t index = count? test_rand() % count: 0;
+
+        if(op <= 1 || count == 0){
+            uint8_t id = alarm_table_add(hour, minute, weekdays, now);
+            if(count == ALARM_TABLE_SIZE){
+                CHECK(id == ALARM_TABLE_INVALID);
+            }
+            else{
+                CHECK(id < ALARM_TABLE_SIZE);
+                ids[count++] = id;
+                check_fire(id, now);
+            }
+        }
+        else if(op == 2){
+            alarm_table_remove(ids[index]);
+            ids[index] = ids[--count];
+        }
+        else if(op == 3){
+            alarm_table_edit(ids[index], hour, minute, weekdays, now);
+            check_fire(ids[index], now);
+        }
+        else if(op == 4){
+            uint32_t fire = now + test_rand() % SECONDS_PER_DAY;
+            alarm_table_snooze(ids[index], fire);
+            CHECK(l_alarms[ids[index]].armed && l_alarms[ids[index]].next_fire == fire);
+        }
+        else if(op == 5){
+            // fire the due alarm the way alarm_task does, the clock moves on to its fire time
+            uint8_t id;
+            uint32_t fire;
+            if(alarm_table_next(&id, &fire)){
+                CHECK(fire == scan_next());
+                if(fire > now){
+                    now = fire;
+                }
+                alarm_table_fired(id, now);
+                check_fire(id, now);
+                CHECK(l_alarms[id].weekdays != ALARM_ONCE || !l_alarms[id].armed);
+            }
+        }
+        else{
+            // a clock step in either direction, as after a network sync
+            now += test_rand() % (2 * SECONDS_PER_DAY);
+            now -= SECONDS_PER_DAY;
+            alarm_table_rebase(now);
+            uint8_t i;
+            for(i = 0; i != count; ++i){
+                check_fire(ids[i], now);
+            }
+        }
+
+        check_heap();
+
+        uint8_t id;
+        uint32_t fire;
+        if(alarm_table_next(&id, &fire)){
+            CHECK(fire == scan_next());
+        }
+        else{
+            CHECK(scan_next() == UINT32_MAX);
+        }
+    }
+}
+
+static void test_snooze_once(void){
+    uint8_t id;
+    uint32_t fire;
+    uint32_t now = TEST_START;
+
+    tz_select(TZ_ZONE_UTC);
+    alarm_table_init();
+
+    id = alarm_table_add(7, 30, ALARM_ONCE, now);
+    CHECK(alarm_table_next(&id, &fire) && fire == now + 7 * SECONDS_PER_HOUR + 30 * SECONDS_PER_MINUTE);
+
+    // a fired one-shot alarm is disarmed but kept, a snooze rearms it
+    alarm_table_fired(id, fire);
+    CHECK(!alarm_table_next(&id, &fire));
+    CHECK(l_alarms[id].in_use);
+    alarm_table_snooze(id, fire + 9 * SECONDS_PER_MINUTE);
+    CHECK(alarm_table_next(&id, &fire) && fire == now + 7 * SECONDS_PER_HOUR + 39 * SECONDS_PER_MINUTE);
+
+    // editing moves it to the new time, the next day once today's time has passed
+    alarm_table_edit(id, 6, 0, ALARM_ONCE, fire);
+    CHECK(alarm_table_next(&id, &fire) && fire == now + SECONDS_PER_DAY + 6 * SECONDS_PER_HOUR);
+
+    alarm_table_remove(id);
+    CHECK(!alarm_table_next(&id, &fire));
+    CHECK(l_heap_size == 0);
+}
+
+static void test_recurring(void){
+    uint8_t id;
+    uint8_t weekend;
+    uint32_t fire;
+    uint32_t now = TEST_START; // a friday
+
+    tz_select(TZ_ZONE_UTC);
+    alarm_table_init();
+
+    weekend = alarm_table_add(9, 0, ALARM_SATURDAY | ALARM_SUNDAY, now);
+    id = alarm_table_add(6, 0, ALARM_EVERY_DAY & ~(ALARM_SATURDAY | ALARM_SUNDAY), now);
+    CHECK(alarm_table_next(&id, &fire) && fire == now + 6 * SECONDS_PER_HOUR);
+
+    // friday's alarm moves on to monday, so saturday's comes first
+    alarm_table_fired(id, fire);
+    CHECK(alarm_table_next(&id, &fire) && id == weekend && fire == now + SECONDS_PER_DAY + 9 * SECONDS_PER_HOUR);
+    alarm_table_fired(id, fire);
+    CHECK(alarm_table_next(&id, &fire) && id == weekend && fire == now + 2 * SECONDS_PER_DAY + 9 * SECONDS_PER_HOUR);
+    alarm_table_fired(id, fire);
+    CHECK(alarm_table_next(&id, &fire) && id != weekend && fire == now + 3 * SECONDS_PER_DAY + 6 * SECONDS_PER_HOUR);
+}
+
+int main(void){
+    uint8_t zone;
+
+    test_snooze_once();
+    test_recurring();
+    for(zone = 0; zone != TZ_ZONE_COUNT; ++zone){
+        test_random(zone);
+    }
+
+    return test_result("alarm_table");
+}
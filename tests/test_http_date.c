@@ -0,0 +1,110 @@
+#define _DEFAULT_SOURCE
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+
+#include "test.h"
+#include "http_date.h"
+
+#define MAX_DATES 4
+
+static uint32_t l_dates[MAX_DATES];
+static uint8_t l_date_count;
+
+static void date_found(uint32_t seconds){
+    if(l_date_count != MAX_DATES){
+        l_dates[l_date_count] = seconds;
+    }
+    ++l_date_count;
+}
+
+// feeds the stream in pieces of at most chunk bytes and returns how many dates were found
+static uint8_t parse(const char *stream, uint16_t chunk){
+    http_date_parser_t parser;
+    uint16_t len = strlen(stream);
+    uint16_t i;
+
+    l_date_count = 0;
+    http_date_parser_init(&parser, date_found);
+    for(i = 0; i < len; i += chunk){
+        http_date_parser_feed(&parser, stream + i, (len - i < chunk)? len - i: chunk);
+    }
+    return l_date_count;
+}
+
+static bool parse_one(const char *value, uint32_t *seconds){
+    char stream[128];
+    snprintf(stream, sizeof(stream), "HTTP/1.1 200 OK\r\nDate: %s\r\n\r\n", value);
+    if(parse(stream, UINT16_MAX) != 1){
+        return false;
+    }
+    *seconds = l_dates[0];
+    return true;
+}
+
+// every second of the unsigned 32 bit range, in strides, against timegm
+static void test_against_timegm(void){
+    uint64_t t;
+    for(t = 0; t <= UINT32_MAX; t += 86399 * 3 + 7){
+        time_t time = (time_t)t;
+        struct tm utc;
+        char value[HTTP_DATE_LEN + 1];
+        uint32_t seconds = 0;
+
+        gmtime_r(&time, &utc);
+        strftime(value, sizeof(value), "%a, %d %b %Y %H:%M:%S GMT", &utc);
+        CHECK(parse_one(value, &seconds));
+        CHECK(seconds == t);
+        CHECK(http_date_days_from_civil(utc.tm_year + 1900, utc.tm_mon + 1, utc.tm_mday) == t / 86400);
+    }
+}
+
+// the header may be split anywhere, also inside the field name and the value
+static void test_split(void){
+    const char *stream = "HTTP/1.1 200 OK\r\nServer: gws\r\nx-date: Mon, 01 Jan 2001 00:00:00 GMT\r\n"
+                         "DATE:\tSun, 06 Nov 1994 08:49:37 GMT\r\nContent-Length: 0\r\n\r\n"
+                         "HTTP/1.1 200 OK\r\ndate: Tue, 29 Feb 2000 23:59:59 GMT\r\n\r\n";
+    uint16_t chunk;
+    for(chunk = 1; chunk != strlen(stream) + 1; ++chunk){
+        CHECK(parse(stream, chunk) == 2);
+        CHECK(l_dates[0] == 784111777);
+        CHECK(l_dates[1] == 951868799);
+    }
+}
+
+static void test_invalid(void){
+    static const char *const invalid[] = {
+        "Fri, 29 Feb 2019 12:00:00 GMT", // not a leap year
+        "Mon, 29 Feb 2100 12:00:00 GMT", // centuries are not leap years unless divisible by 400
+        "Thu, 31 Apr 2020 12:00:00 GMT",
+        "Sat, 00 Jan 2000 12:00:00 GMT",
+        "Sat, 32 Jan 2000 12:00:00 GMT",
+        "Sat, 01 Jam 2000 12:00:00 GMT",
+        "Sat, 01 Jan 2000 24:00:00 GMT",
+        "Sat, 01 Jan 2000 12:60:00 GMT",
+        "Sat, 01 Jan 2000 12:00:61 GMT",
+        "Sat, 01 Jan 2000 12:00:00 UTC",
+        "Sat, 1 Jan 2000 12:00:00 GMT",
+        "Sat, 01 Jan 2000 12:0a:00 GMT",
+        "Saturday, 01-Jan-00 12:00:00 GMT",
+        "",
+    };
+    uint8_t i;
+    for(i = 0; i != sizeof(invalid) / sizeof(invalid[0]); ++i){
+        uint32_t seconds;
+        CHECK(!parse_one(invalid[i], &seconds));
+    }
+
+    // a leap second reads as the first second of the next minute
+    uint32_t seconds = 0;
+    CHECK(parse_one("Wed, 31 Dec 2025 23:59:60 GMT", &seconds) && seconds == 1767225600);
+}
+
+int main(void){
+    test_against_timegm();
+    test_split();
+    test_invalid();
+    return test_result("http_date");
+}
@@ -0,0 +1,260 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "test.h"
+
+// white box, the discipline state is checked directly
+#include "../rtc_time.c"
+
+#define TEST_START 1700000000.3
+#define PPM 1e-6
+#define SECONDS_PER_MINUTE 60
+#define SECONDS_PER_HOUR 3600
+#define SECONDS_PER_DAY 86400
+
+uint32_t g_ui32SysClock = 120000000;
+
+// the hibernation module, with the RTC as a count of seconds since the epoch that runs
+// at the crystal error plus the programmed trim, and the battery-backed memory
+static struct{
+    double rtc;
+    double crystal_error;
+    uint32_t trim;
+    uint32_t data[16];
+    bool active;
+    uint32_t steps;
+}l_hib;
+
+void HibernateEnableExpClk(uint32_t ui32HibClk){
+    (void)ui32HibClk;
+}
+
+uint32_t HibernateIsActive(void){
+    return l_hib.active;
+}
+
+void HibernateClockConfig(uint32_t ui32Config){
+    (void)ui32Config;
+}
+
+void HibernateCounterMode(uint32_t ui32Config){
+    (void)ui32Config;
+}
+
+void HibernateRTCEnable(void){
+    l_hib.active = true;
+}
+
+void HibernateRTCSet(uint32_t ui32RTCValue){
+    l_hib.rtc = ui32RTCValue;
+    ++l_hib.steps;
+}
+
+uint32_t HibernateRTCGet(void){
+    return (uint32_t)l_hib.rtc;
+}
+
+uint32_t HibernateRTCSSGet(void){
+    return (uint32_t)((l_hib.rtc - floor(l_hib.rtc)) * RTC_SUBSECONDS_PER_SECOND);
+}
+
+void HibernateRTCTrimSet(uint32_t ui32Trim){
+    l_hib.trim = ui32Trim;
+}
+
+void HibernateDataSet(uint32_t *pui32Data, uint32_t ui32Count){
+    memcpy(l_hib.data, pui32Data, ui32Count * sizeof(uint32_t));
+}
+
+void HibernateDataGet(uint32_t *pui32Data, uint32_t ui32Count){
+    memcpy(pui32Data, l_hib.data, ui32Count * sizeof(uint32_t));
+}
+
+// true time in seconds, the RTC follows it at its own rate
+static double l_real;
+static uint32_t l_rand_state = 1;
+
+static double test_rand(void){
+    l_rand_state = l_rand_state * 1103515245u + 12345u;
+    return (double)(l_rand_state >> 8) / (1 << 24);
+}
+
+// a negative trim makes the RTC faster, by 2^-21 per count
+static void advance(double seconds){
+    double trim = (double)l_hib.trim - RTC_TRIM_NOMINAL;
+    l_hib.rtc += seconds * (1 + l_hib.crystal_error) * (1 - trim / (1 << RTC_TRIM_RATE_SHIFT));
+    l_real += seconds;
+}
+
+// runs the clock for a while with time_task's minute wake-ups
+static void run(double seconds){
+    while(seconds > 0){
+        double step = (seconds < SECONDS_PER_MINUTE)? seconds: SECONDS_PER_MINUTE;
+        advance(step);
+        rtc_time_tick();
+        seconds -= step;
+    }
+}
+
+static void power_on(double crystal_error){
+    memset(&l_hib, 0, sizeof(l_hib));
+    l_hib.crystal_error = crystal_error;
+    l_real = TEST_START;
+    rtc_time_init();
+}
+
+// resets the processor, the hibernation module and its memory stay as they are
+static void reset(void){
+    memset(&l_rtc, 0, sizeof(l_rtc));
+    rtc_time_init();
+}
+
+static void sample_sntp(void){
+    double fraction = l_real - floor(l_real);
+    rtc_time_sample((uint32_t)l_real, (uint32_t)(fraction * 4294967296.0), 0);
+}
+
+// the Date header has the whole second the server saw, the middle of that second is the best guess
+static void sample_http(void){
+    rtc_time_sample((uint32_t)l_real, 0x80000000, RTC_SUBSECONDS_PER_SECOND);
+}
+
+static double error(void){
+    return l_hib.rtc - l_real;
+}
+
+// after the network goes away the clock keeps running at the measured rate instead of the slew rate
+static void test_network_drop(void){
+    uint32_t hour;
+
+    // the first sample steps to the whole second and leaves 0.3 s to slew, the drift is measured from it
+    power_on(30 * PPM);
+    for(hour = 0; hour != 3; ++hour){
+        sample_sntp();
+        CHECK(l_rtc.trim != l_rtc.freq);
+        run(SECONDS_PER_HOUR / 2 + test_rand());
+    }
+    CHECK(l_rtc.freq_valid);
+    CHECK(fabs(l_rtc.freq - 30 * PPM * (1 << RTC_TRIM_RATE_SHIFT)) < 2);
+    CHECK(l_hib.steps == 1);
+
+    // the slew of the last sample ends on its own, then nothing for a day
+    run(SECONDS_PER_HOUR / 2 + SECONDS_PER_MINUTE);
+    CHECK(l_rtc.trim == l_rtc.freq);
+    CHECK(fabs(error()) < 0.01);
+    run(SECONDS_PER_DAY);
+    CHECK(fabs(error()) < 0.05);
+}
+
+// a reset during a slew takes the slew over, and a slew that ran out meanwhile ends right away
+static void test_restore_slew(void){
+    power_on(-20 * PPM);
+    sample_sntp();
+    run(SECONDS_PER_HOUR / 2);
+    int32_t trim = l_rtc.trim;
+    CHECK(trim < l_rtc.freq);
+
+    reset();
+    CHECK(l_rtc.valid && l_rtc.trim == trim);
+
+    // held in reset until just past the end of the slew
+    advance(SECONDS_PER_HOUR / 2 + SECONDS_PER_MINUTE);
+    reset();
+    CHECK(l_rtc.valid && l_rtc.trim == l_rtc.freq);
+
+    // the trim integral went on through both resets, so the drift is measured right
+    run(SECONDS_PER_HOUR);
+    sample_sntp();
+    CHECK(l_rtc.freq_valid);
+    CHECK(fabs(l_rtc.freq + 20 * PPM * (1 << RTC_TRIM_RATE_SHIFT)) < 2);
+    CHECK(l_hib.steps == 1);
+}
+
+// a saved state is taken over after a reset, a damaged or stale one is not
+static void test_checkpoint(void){
+    rtc_discipline_t saved;
+    uint32_t data[16];
+    uint32_t word;
+    uint32_t bit;
+
+    power_on(10 * PPM);
+    sample_sntp();
+    run(SECONDS_PER_HOUR + SECONDS_PER_MINUTE);
+    sample_sntp();
+    CHECK(l_rtc.freq_valid);
+    CHECK(RTC_CHECKPOINT_WORDS <= sizeof(l_hib.data) / sizeof(uint32_t));
+
+    saved = l_rtc;
+    reset();
+    CHECK(l_rtc.valid);
+    CHECK(l_rtc.anchor == saved.anchor && l_rtc.anchor_offset == saved.anchor_offset);
+    CHECK(l_rtc.trim_sum == saved.trim_sum && l_rtc.trim_since == saved.trim_since);
+    CHECK(l_rtc.slew_end == saved.slew_end && l_rtc.freq == saved.freq && l_rtc.trim == saved.trim);
+    CHECK(l_rtc.freq_valid);
+    CHECK(l_hib.steps == 1);
+
+    // every single bit error is caught by the crc
+    memcpy(data, l_hib.data, sizeof(data));
+    for(word = 0; word != RTC_CHECKPOINT_WORDS; ++word){
+        for(bit = 0; bit != 32; ++bit){
+            l_hib.data[word] ^= 1u << bit;
+            reset();
+            CHECK(!l_rtc.valid);
+            memcpy(l_hib.data, data, sizeof(data));
+        }
+    }
+
+    // a checkpoint of the earlier layout
+    l_hib.data[0] = 0x52544331;
+    l_hib.data[RTC_CHECKPOINT_WORDS - 1] = rtc_checkpoint_crc((const rtc_checkpoint_t*)l_hib.data);
+    reset();
+    CHECK(!l_rtc.valid);
+    memcpy(l_hib.data, data, sizeof(data));
+
+    // the power went away, the module starts from scratch
+    l_hib.active = false;
+    reset();
+    CHECK(!l_rtc.valid && l_hib.active);
+
+    // the counter restarted behind the checkpoint, e.g. after the battery ran out
+    double rtc = l_hib.rtc;
+    l_hib.rtc = 0;
+    reset();
+    CHECK(!l_rtc.valid);
+
+    // an intact checkpoint still works after the failed attempts
+    l_hib.rtc = rtc;
+    advance(SECONDS_PER_MINUTE);
+    reset();
+    CHECK(l_rtc.valid);
+    sample_sntp();
+    CHECK(l_hib.steps == 1);
+}
+
+// hourly Date headers with 1 s resolution over two weeks neither step the clock nor pull the frequency away
+static void test_http(void){
+    uint32_t hour;
+    double worst = 0;
+
+    power_on(30 * PPM);
+    for(hour = 0; hour != 14 * 24; ++hour){
+        sample_http();
+        if(hour >= 48 && fabs(error()) > worst){
+            worst = fabs(error());
+        }
+        run(SECONDS_PER_HOUR + 3 * test_rand());
+    }
+    printf("http: worst error %.3f s, freq %d, %u steps\n", worst, l_rtc.freq, l_hib.steps);
+    CHECK(l_hib.steps == 1);
+    CHECK(worst < 1.0);
+    CHECK(fabs(l_rtc.freq - 30 * PPM * (1 << RTC_TRIM_RATE_SHIFT)) < 8);
+}
+
+int main(void){
+    test_network_drop();
+    test_restore_slew();
+    test_checkpoint();
+    test_http();
+    return test_result("rtc_time");
+}
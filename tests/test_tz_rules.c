@@ -0,0 +1,106 @@
+#define _DEFAULT_SOURCE
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "test.h"
+#include "tz_rules.h"
+
+// 2100-12-31 23:59:59 UTC
+#define SWEEP_END 4133980799u
+#define SWEEP_STEP 7200u
+
+static int32_t glibc_offset(uint32_t utc, const char **abbr){
+    time_t time = utc;
+    struct tm local;
+    localtime_r(&time, &local);
+    if(abbr != NULL){
+        *abbr = local.tm_zone;
+    }
+    return local.tm_gmtoff;
+}
+
+// compares one utc time with glibc, through the cache of the sweep and through a cold cache
+static void check_utc(tz_cache_t *cache, uint32_t utc){
+    const char *abbr;
+    const char *expected_abbr;
+    int32_t expected = glibc_offset(utc, &expected_abbr);
+
+    uint32_t local = tz_to_local(cache, utc, &abbr);
+    CHECK(local == utc + expected);
+    CHECK(strcmp(abbr, expected_abbr) == 0);
+
+    tz_cache_t cold;
+    tz_cache_init(&cold);
+    CHECK(tz_to_local(&cold, utc, NULL) == local);
+
+    // a repeated local time resolves to its later occurrence
+    uint32_t back = tz_to_utc(&cold, local);
+    CHECK(back == utc || (back > utc && back + glibc_offset(back, NULL) == local));
+}
+
+// the local times between two offsets never happen, they are moved forward by the shift
+static void check_gap(tz_cache_t *cache, uint32_t transition, int32_t before, int32_t after){
+    uint32_t local;
+    for(local = transition + before; local != transition + after; local += 60){
+        uint32_t utc = tz_to_utc(cache, local);
+        CHECK(utc == local - before);
+        CHECK(tz_to_local(cache, utc, NULL) == local + (after - before));
+    }
+}
+
+static void test_zone(uint8_t zone){
+    tz_cache_t cache;
+    uint32_t utc;
+    uint32_t transitions = 0;
+    uint32_t prev = 0;
+    int32_t prev_offset;
+
+    tz_select(zone);
+    CHECK(tz_selected() == zone);
+    setenv("TZ", tz_zone(zone)->posix, 1);
+    tzset();
+    tz_cache_init(&cache);
+
+    prev_offset = glibc_offset(0, NULL);
+    for(utc = 0; utc <= SWEEP_END && utc >= prev; prev = utc, utc += SWEEP_STEP){
+        int32_t offset = glibc_offset(utc, NULL);
+        if(offset != prev_offset){
+            // the exact second of the change, checked on both sides
+            uint32_t low = prev;
+            uint32_t high = utc;
+            while(high - low > 1){
+                uint32_t mid = low + (high - low) / 2;
+                if(glibc_offset(mid, NULL) == prev_offset){
+                    low = mid;
+                }
+                else{
+                    high = mid;
+                }
+            }
+            check_utc(&cache, high - 1);
+            check_utc(&cache, high);
+            if(offset > prev_offset){
+                check_gap(&cache, high, prev_offset, offset);
+            }
+            prev_offset = offset;
+            ++transitions;
+        }
+        check_utc(&cache, utc);
+    }
+
+    // 1970 to 2100 has 131 years with a start and an end each
+    CHECK(transitions == (tz_zone(zone)->has_dst? 262: 0));
+}
+
+int main(void){
+    uint8_t zone;
+    for(zone = 0; zone != TZ_ZONE_COUNT; ++zone){
+        test_zone(zone);
+    }
+    CHECK(tz_zone(TZ_ZONE_COUNT) == NULL);
+    return test_result("tz_rules");
+}
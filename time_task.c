@@ -11,108 +11,268 @@
 
 #include "utils/lwiplib.h"
 
+#include "lwip/tcpip.h"
+
 #include "http/http_client.h"
 
+#include "http_date.h"
+#include "sntp_client.h"
+#include "rtc_time.h"
+#include "tz_rules.h"
 #include "time_struct.h"
 #include "priorities.h"
 #include "button_pins.h"
 
 #define TIME_TASK_SIZE_WORDS 250
 
+// how often to check for an IP address, and to retry the http request until the first sample arrives
 #define TIME_INTERVAL_MILLISECONDS 500
 
+// the RTC keeps the time between samples, so the network is only asked once per sync interval
+#define TIME_SYNC_INTERVAL_MILLISECONDS (RTC_SYNC_INTERVAL_SECONDS * 1000)
+
+// 1 to get the time from an NTP server over UDP, 0 to read the Date header of http responses from google.com
+#ifndef TIME_USE_SNTP
+#define TIME_USE_SNTP 1
+#endif
+
+#define SECONDS_PER_DAY 86400
+#define SECONDS_PER_HOUR 3600
+#define SECONDS_PER_MINUTE 60
+
 time_t g_cur_time;
+// abbreviation of the zone g_cur_time is shown in, e.g. "PST" or "PDT"
+const char *g_cur_zone;
 
-extern TaskHandle_t lcd_task_handle;
-extern TaskHandle_t alarm_task_handle;
+extern void lcd_invalidate(void);
 
-extern volatile bool alarm_set;
-extern volatile time_t user_time;
+extern void alarm_rebase(void);
 
-extern volatile bool alarm_ringing;
+static TaskHandle_t l_time_task_handle;
 
 static uint32_t l_ui32IPAddress;
+
+static tz_cache_t l_tz_cache;
+
+// a network sample waiting for time_task, which is the only task that disciplines the RTC
+// written from the tcpip thread, so it is only accessed in critical sections
+typedef struct time_sample_t{
+    uint32_t seconds;
+    uint32_t fraction;
+    uint32_t resolution;
+    TickType_t received;
+    bool pending;
+}time_sample_t;
+
+static time_sample_t l_sample;
+
+#if TIME_USE_SNTP
+static const ip_addr_t IP_ADDR_GOOGLE_NTP = {0x0023efd8}; // time.google.com, 216.239.35.0
+#else
 static const ip_addr_t IP_ADDR_GOOGLE = {0xae2efb8e};
 
-static void result(void *arg, httpc_result_t httpc_result, u32_t rx_content_len, u32_t srv_res, err_t err){
+static httpc_connection_t l_http_settings;
 
-}
+// persistent connection to google.com, NULL while there is none
+// only touched from the tcpip thread
+static httpc_state_t *l_connection;
+
+// scans the header lines of l_connection for the Date field
+static http_date_parser_t l_date_parser;
+static bool l_date_found;
 
-// convert to PST
-static inline uint8_t gmt_to_pst_hour(uint8_t gmt_hour){
-    return (gmt_hour >= 8)? gmt_hour - 8: gmt_hour + 16;
+// the persistent connection reports HTTPC_RESULT_OK after every response,
+// any other result means it has been closed and has to be reopened
+static void result(void *arg, httpc_result_t httpc_result, u32_t rx_content_len, u32_t srv_res, err_t err){
+    if(httpc_result != HTTPC_RESULT_OK){
+        l_connection = NULL;
+    }
 }
+#endif
 
-// finds the date field in the http header and stores it in g_cur_time
-// returns ERR_ABRT because we only need the header in order to get the current time
-// if the time changes, it updates the g_cur_time variable and allows
+// stores a new local time in g_cur_time
+// if the time or the zone changes, it updates the g_cur_time variable and allows
 // one loop of lcd_task to run to update the lcd with the current time
-static err_t header(httpc_state_t *connection, void *arg, struct pbuf *hdr, u16_t hdr_len, u32_t content_len){
+static void time_set(uint8_t hour, uint8_t minute, const char *zone){
 
-    char *payload_ptr = (char*)(hdr->payload);
+    if(minute != g_cur_time.minute || hour != g_cur_time.hour || zone != g_cur_zone){
+        taskENTER_CRITICAL();
 
-    uint16_t i;
-    for(i = 0; i != hdr_len; ++i){
-        if(payload_ptr[i] == 'D' &&
-           hdr_len - i > 34 &&
-           payload_ptr[i + 1] == 'a' &&
-           payload_ptr[i + 2] == 't' &&
-           payload_ptr[i + 3] == 'e' &&
-           payload_ptr[i + 4] == ':'){
+        g_cur_time.hour = hour;
+        g_cur_time.minute = minute;
+        g_cur_zone = zone;
 
-            uint8_t http_hour = (payload_ptr[i + 23] - '0') * 10 + (payload_ptr[i + 24] - '0');
-            uint8_t pst_hour = gmt_to_pst_hour(http_hour);
+        taskEXIT_CRITICAL();
 
-            uint8_t http_minute = (payload_ptr[i + 26] - '0') * 10 + (payload_ptr[i + 27] - '0');
+        lcd_invalidate();
+    }
+}
 
-            if(http_minute != g_cur_time.minute || pst_hour != g_cur_time.hour){
-                taskENTER_CRITICAL();
+// hands a network sample over to time_task, a newer sample replaces one that wasn't applied yet
+static void time_sample_post(uint32_t seconds, uint32_t fraction, uint32_t resolution){
+    taskENTER_CRITICAL();
 
-                g_cur_time.hour = pst_hour;
-                g_cur_time.minute = http_minute;
+    l_sample.seconds = seconds;
+    l_sample.fraction = fraction;
+    l_sample.resolution = resolution;
+    l_sample.received = xTaskGetTickCount();
+    l_sample.pending = true;
 
-                taskEXIT_CRITICAL();
+    taskEXIT_CRITICAL();
 
-                vTaskResume(lcd_task_handle);
+    xTaskNotifyGive(l_time_task_handle);
+}
 
-                // sends control to the alarm task if the current time equals the set alarm time
-                // disables all button GPIO interrupts except SET_ALARM because that is the only way to exit the alarm task
-                // not disabling other interrupts caused the speed of the alarm buzzer to be changeable
-                // by pressing the other buttons because of the debounce time inside the ISR for the button interrupts
-                if(user_time.minute == g_cur_time.minute && user_time.hour == g_cur_time.hour && alarm_set){
-                    alarm_ringing = true;
-                    GPIOIntDisable(GPIO_PORTK_BASE, HOUR_UP_PIN | HOUR_DOWN_PIN | MINUTE_UP_PIN | MINUTE_DOWN_PIN);
-                    vTaskResume(alarm_task_handle);
-                }
+// disciplines the RTC with the pending sample, moved on by the time it waited for this task
+// returns false if there was none
+static bool time_sample_apply(void){
+    time_sample_t sample;
 
-                break;
-            }
-        }
+    taskENTER_CRITICAL();
+
+    sample = l_sample;
+    l_sample.pending = false;
+
+    taskEXIT_CRITICAL();
+
+    if(!sample.pending){
+        return false;
     }
 
-    return ERR_ABRT;
+    uint64_t waited_ms = (uint64_t)(xTaskGetTickCount() - sample.received) * portTICK_PERIOD_MS;
+    uint64_t fraction = sample.fraction + (waited_ms << 32) / 1000;
+    rtc_time_sample(sample.seconds + (uint32_t)(fraction >> 32), (uint32_t)fraction, sample.resolution);
+    return true;
+}
+
+#if TIME_USE_SNTP
+// called by the sntp client with the current UTC time
+static void sntp_sample(uint32_t seconds, uint32_t fraction){
+    time_sample_post(seconds, fraction, 0);
+}
+#else
+// called by the date parser with the time from a Date header
+// the header only has whole seconds, so the time is somewhere in the second after it
+static void date_found(uint32_t seconds){
+    time_sample_post(seconds, 0x80000000, RTC_SUBSECONDS_PER_SECOND);
+    l_date_found = true;
 }
 
-static err_t recv(void *arg, struct tcp_pcb *tpcb, struct pbuf *p, err_t err){
+// called by http_client with every header line as soon as it arrives
+// feeds the line to the date parser, walking the pbuf chain since a line can span segments,
+// and stops the header once the Date line was found so the rest is never buffered
+static err_t header_line(void *arg, struct pbuf *hdr, u16_t offset, u16_t len){
+    struct pbuf *q;
+    for(q = hdr; q != NULL && len != 0; q = q->next){
+        if(offset >= q->len){
+            offset -= q->len;
+            continue;
+        }
+        u16_t n = (q->len - offset < len)? q->len - offset: len;
+        http_date_parser_feed(&l_date_parser, (const char*)q->payload + offset, n);
+        offset = 0;
+        len -= n;
+    }
+    http_date_parser_feed(&l_date_parser, "\n", 1);
+
+    if(l_date_found){
+        l_date_found = false;
+        return ERR_ABRT;
+    }
     return ERR_OK;
 }
 
-// gets the time from an http request to google.com every INTERVAL_MILLISECONDS and converts it from GMT to PST
+// sends one HEAD request to google.com, reusing the persistent connection if it is still open
+// runs in the tcpip thread so that the connection state is never shared with time_task
+static void time_request(void *ctx){
+    if(l_connection == NULL){
+        if(httpc_keepalive_open(&IP_ADDR_GOOGLE, HTTP_DEFAULT_PORT, "/", &l_http_settings, NULL, &l_connection) == ERR_OK){
+            http_date_parser_init(&l_date_parser, date_found);
+            l_date_found = false;
+            httpc_set_header_line_fn(l_connection, header_line);
+        }
+    }
+    else{
+        httpc_keepalive_head(l_connection);
+    }
+}
+#endif
+
+// keeps g_cur_time up to date from the hibernate RTC, waking up once per minute to show the new minute
+// the RTC is disciplined once per TIME_SYNC_INTERVAL_MILLISECONDS by a network sample, so the clock
+// keeps running when ethernet is down
+// with TIME_USE_SNTP the samples come from time.google.com over NTP, polled by sntp_client from the tcpip thread
+// otherwise they come from the Date header of an http request to google.com
 // makes use of http_client from lwip 2.2.0 modified to work with lwip 1.4.1, which TI provides a library for
+// the requests are HEAD requests on one keep-alive connection, which is reopened if the server closed it
+// it doesn't outlive the hour between syncs, so keep-alive only saves handshakes while the first sample is retried
+// either way the time is converted from UTC to the local time of the selected zone, following dst
 static void time_task(void *args){
 
-    const char empty[] = "/";
-    httpc_connection_t http_settings;
-    http_settings.use_proxy = 0;
-    http_settings.result_fn = result;
-    http_settings.headers_done_fn = header;
+#if !TIME_USE_SNTP
+    l_http_settings.use_proxy = 0;
+    l_http_settings.result_fn = result;
+    l_http_settings.headers_done_fn = NULL;
+
+    TickType_t next_request = xTaskGetTickCount();
+#endif
+
+    bool network_up = false;
 
     while(1){
-        l_ui32IPAddress = lwIPLocalIPAddrGet();
-        if(l_ui32IPAddress != 0x0 && l_ui32IPAddress != 0xffffffff){
-            httpc_get_file(&IP_ADDR_GOOGLE, HTTP_DEFAULT_PORT, empty, &http_settings, recv, NULL, NULL);
+        if(!network_up){
+            l_ui32IPAddress = lwIPLocalIPAddrGet();
+            network_up = l_ui32IPAddress != 0x0 && l_ui32IPAddress != 0xffffffff;
+#if TIME_USE_SNTP
+            if(network_up){
+                sntp_client_start(&IP_ADDR_GOOGLE_NTP, TIME_SYNC_INTERVAL_MILLISECONDS, sntp_sample);
+            }
+#endif
+        }
+
+        // keep checking for an IP address until there is one, after that only wake up when there is work
+        TickType_t wait = network_up? portMAX_DELAY: pdMS_TO_TICKS(TIME_INTERVAL_MILLISECONDS);
+
+#if !TIME_USE_SNTP
+        if(network_up){
+            TickType_t now = xTaskGetTickCount();
+            if((int32_t)(now - next_request) >= 0){
+                tcpip_callback(time_request, NULL);
+                // this is only the retry deadline, a response moves it one sync interval past its own arrival
+                next_request = now + pdMS_TO_TICKS(rtc_time_valid()? TIME_SYNC_INTERVAL_MILLISECONDS: TIME_INTERVAL_MILLISECONDS);
+            }
+            wait = next_request - now;
+        }
+#endif
+
+        // the phase correction of the last sample only lasts one sync interval
+        rtc_time_tick();
+
+        if(rtc_time_valid()){
+            uint32_t seconds;
+            uint32_t subseconds;
+            rtc_time_get(&seconds, &subseconds);
+
+            const char *zone;
+            uint32_t day_seconds = tz_to_local(&l_tz_cache, seconds, &zone) % SECONDS_PER_DAY;
+            time_set(day_seconds / SECONDS_PER_HOUR, (day_seconds % SECONDS_PER_HOUR) / SECONDS_PER_MINUTE, zone);
+
+            // sleep until just after the next minute starts
+            uint32_t minute_ms = (SECONDS_PER_MINUTE - seconds % SECONDS_PER_MINUTE) * 1000 -
+                                 subseconds * 1000 / RTC_SUBSECONDS_PER_SECOND;
+            if(pdMS_TO_TICKS(minute_ms) + 1 < wait){
+                wait = pdMS_TO_TICKS(minute_ms) + 1;
+            }
+        }
+
+        // a new sample notifies the task so that a stepped clock is shown right away
+        // the sample may have stepped the RTC over the programmed alarm match, so the alarms are recomputed
+        if(ulTaskNotifyTake(pdTRUE, wait) != 0 && time_sample_apply()){
+#if !TIME_USE_SNTP
+            next_request = xTaskGetTickCount() + pdMS_TO_TICKS(TIME_SYNC_INTERVAL_MILLISECONDS);
+#endif
+            alarm_rebase();
         }
-        vTaskDelay(TIME_INTERVAL_MILLISECONDS / portTICK_PERIOD_MS);
     }
 
 }
@@ -121,5 +281,12 @@ static void time_task(void *args){
 void inline time_task_init(void){
     g_cur_time.hour = UNSET_HOUR;
     g_cur_time.minute = UNSET_MINUTE;
-    xTaskCreate(time_task, "time_task", TIME_TASK_SIZE_WORDS, NULL, PRIORITY_TIME_TASK, NULL);
+    g_cur_zone = tz_zone(tz_selected())->std_abbr;
+#if !TIME_USE_SNTP
+    l_connection = NULL;
+#endif
+    l_sample.pending = false;
+    tz_cache_init(&l_tz_cache);
+    rtc_time_init();
+    xTaskCreate(time_task, "time_task", TIME_TASK_SIZE_WORDS, NULL, PRIORITY_TIME_TASK, &l_time_task_handle);
 }
@@ -0,0 +1,81 @@
+#!/usr/bin/env python3
+# Reads the stats snapshots sent by stats.c and prints a top like view.
+# Usage: stats_top.py /dev/ttyACM0   (or a file with a captured byte stream)
+# The CPU column is the share of the run time counter between two snapshots.
+
+import struct
+import sys
+
+SYNC = b'\xa5\x5a'
+NAME_LEN = 12
+HEADER = struct.Struct('<BBIIIIII')
+TASK = struct.Struct('<BBB%dsIH' % NAME_LEN)
+STATES = ['run', 'ready', 'block', 'susp', 'del', 'inv']
+
+
+def crc16(data):
+    crc = 0
+    for byte in data:
+        crc ^= byte
+        for _ in range(8):
+            crc = (crc >> 1) ^ 0xa001 if crc & 1 else crc >> 1
+    return crc
+
+
+def frames(stream):
+    buf = b''
+    while True:
+        chunk = stream.read(64)
+        if not chunk:
+            return
+        buf += chunk
+        while True:
+            start = buf.find(SYNC)
+            if start < 0 or len(buf) < start + 4:
+                break
+            length = struct.unpack_from('<H', buf, start + 2)[0]
+            end = start + 4 + length + 2
+            if len(buf) < end:
+                break
+            payload = buf[start + 4:start + 4 + length]
+            if struct.unpack_from('<H', buf, end - 2)[0] == crc16(payload):
+                yield payload
+                buf = buf[end:]
+            else:
+                buf = buf[start + 1:]
+
+
+def parse(payload):
+    version, count, tick, run_time, heap, heap_low, sleeps, sleep_time = HEADER.unpack_from(payload)
+    tasks = {}
+    for i in range(count):
+        number, state, priority, name, task_time, stack = TASK.unpack_from(payload, HEADER.size + i * TASK.size)
+        tasks[number] = (name.rstrip(b'\0').decode(), state, priority, task_time, stack)
+    return tick, run_time, heap, heap_low, sleeps, sleep_time, tasks
+
+
+def main():
+    stream = open(sys.argv[1], 'rb', buffering=0)
+    last = None
+    for payload in frames(stream):
+        tick, run_time, heap, heap_low, sleeps, sleep_time, tasks = parse(payload)
+        print('\x1b[2J\x1b[Htick %u  heap free %u  lowest %u' % (tick, heap, heap_low))
+        if last is not None:
+            total = (run_time - last[0]) & 0xffffffff
+            asleep = (sleep_time - last[3]) & 0xffffffff
+            if total:
+                print('asleep %.1f%%  wakes %u' % (100.0 * asleep / total, (sleeps - last[2]) & 0xffffffff))
+        print('%-3s %-12s %-5s %4s %6s %10s' % ('#', 'name', 'state', 'prio', 'cpu%', 'stack free'))
+        for number in sorted(tasks):
+            name, state, priority, task_time, stack = tasks[number]
+            cpu = ''
+            if last is not None and number in last[1]:
+                total = (run_time - last[0]) & 0xffffffff
+                used = (task_time - last[1][number][3]) & 0xffffffff
+                cpu = '%.1f' % (100.0 * used / total) if total else ''
+            print('%-3u %-12s %-5s %4u %6s %10u' % (number, name, STATES[min(state, 5)], priority, cpu, stack))
+        last = (run_time, tasks, sleeps, sleep_time)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,150 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "http_date.h"
+#include "tz_rules.h"
+
+#define SECONDS_PER_DAY 86400
+#define SECONDS_PER_HOUR 3600
+
+// 1970-01-01 was a thursday
+#define EPOCH_WEEKDAY 4
+
+#define TZ_HOURS(hours) ((int32_t)(hours) * SECONDS_PER_HOUR)
+#define TZ_RULE(month, week, weekday, hours) {month, week, weekday, TZ_HOURS(hours)}
+#define TZ_NO_RULE {0, 0, 0, 0}
+
+// offsets are seconds east of UTC, so the sign is the opposite of the POSIX string
+static const tz_zone_t l_zones[TZ_ZONE_COUNT] = {
+    [TZ_ZONE_UTC] = {"UTC0", "UTC", "UTC", 0, 0, false, TZ_NO_RULE, TZ_NO_RULE},
+    [TZ_ZONE_LONDON] = {"GMT0BST,M3.5.0/1,M10.5.0", "GMT", "BST", 0, TZ_HOURS(1), true,
+                        TZ_RULE(3, 5, 0, 1), TZ_RULE(10, 5, 0, 2)},
+    [TZ_ZONE_EASTERN] = {"EST5EDT,M3.2.0,M11.1.0", "EST", "EDT", TZ_HOURS(-5), TZ_HOURS(-4), true,
+                         TZ_RULE(3, 2, 0, 2), TZ_RULE(11, 1, 0, 2)},
+    [TZ_ZONE_CENTRAL] = {"CST6CDT,M3.2.0,M11.1.0", "CST", "CDT", TZ_HOURS(-6), TZ_HOURS(-5), true,
+                         TZ_RULE(3, 2, 0, 2), TZ_RULE(11, 1, 0, 2)},
+    [TZ_ZONE_MOUNTAIN] = {"MST7MDT,M3.2.0,M11.1.0", "MST", "MDT", TZ_HOURS(-7), TZ_HOURS(-6), true,
+                          TZ_RULE(3, 2, 0, 2), TZ_RULE(11, 1, 0, 2)},
+    [TZ_ZONE_ARIZONA] = {"MST7", "MST", "MST", TZ_HOURS(-7), TZ_HOURS(-7), false, TZ_NO_RULE, TZ_NO_RULE},
+    [TZ_ZONE_PACIFIC] = {"PST8PDT,M3.2.0,M11.1.0", "PST", "PDT", TZ_HOURS(-8), TZ_HOURS(-7), true,
+                         TZ_RULE(3, 2, 0, 2), TZ_RULE(11, 1, 0, 2)},
+    [TZ_ZONE_HAWAII] = {"HST10", "HST", "HST", TZ_HOURS(-10), TZ_HOURS(-10), false, TZ_NO_RULE, TZ_NO_RULE}
+};
+
+static const tz_zone_t *volatile l_zone = &l_zones[TZ_DEFAULT_ZONE];
+
+// the caches notice the change the next time they are used
+// alarms computed with the old zone have to be rebased by the caller
+void tz_select(uint8_t zone){
+    if(zone < TZ_ZONE_COUNT){
+        l_zone = &l_zones[zone];
+    }
+}
+
+uint8_t tz_selected(void){
+    return l_zone - l_zones;
+}
+
+const tz_zone_t *tz_zone(uint8_t zone){
+    return (zone < TZ_ZONE_COUNT)? &l_zones[zone]: NULL;
+}
+
+void tz_cache_init(tz_cache_t *cache){
+    cache->zone = NULL;
+}
+
+// local wall clock seconds at which a rule fires in the given year
+static int64_t tz_rule_local(const tz_rule_t *rule, uint32_t year){
+
+    int32_t first = (int32_t)http_date_days_from_civil(year, rule->month, 1);
+    int32_t next = (rule->month == 12)? (int32_t)http_date_days_from_civil(year + 1, 1, 1):
+                                        (int32_t)http_date_days_from_civil(year, rule->month + 1, 1);
+
+    int32_t first_weekday = (first % 7 + 7 + EPOCH_WEEKDAY) % 7;
+    int32_t day = first + (rule->weekday + 7 - first_weekday) % 7 + (rule->week - 1) * 7;
+    while(day >= next){
+        day -= 7;
+    }
+
+    return (int64_t)day * SECONDS_PER_DAY + rule->time;
+}
+
+// finds the transitions around utc and stores the interval between them in the cache
+static void tz_cache_fill(tz_cache_t *cache, const tz_zone_t *zone, uint32_t utc){
+
+    cache->zone = zone;
+    cache->from = 0;
+    cache->until = UINT32_MAX;
+    cache->offset = zone->std_offset;
+    cache->abbr = zone->std_abbr;
+
+    if(!zone->has_dst){
+        return;
+    }
+
+    // the transitions of the year before, this year and the next year bracket utc
+    // a dst start is given in standard time and a dst end in daylight time
+    uint32_t year = 1970 + (uint32_t)(((int64_t)utc + zone->std_offset) / (SECONDS_PER_DAY * 365));
+    int64_t from = INT64_MIN;
+    int64_t until = INT64_MAX;
+    bool dst = false;
+    int8_t i;
+    for(i = -2; i != 2; ++i){
+        int64_t start = tz_rule_local(&zone->dst_start, year + i) - zone->std_offset;
+        int64_t end = tz_rule_local(&zone->dst_end, year + i) - zone->dst_offset;
+        if(start <= utc && start > from){
+            from = start;
+            dst = true;
+        }
+        if(end <= utc && end > from){
+            from = end;
+            dst = false;
+        }
+        if(start > utc && start < until){
+            until = start;
+        }
+        if(end > utc && end < until){
+            until = end;
+        }
+    }
+
+    if(from > 0){
+        cache->from = (uint32_t)from;
+    }
+    if(until < UINT32_MAX){
+        cache->until = (uint32_t)until;
+    }
+    if(dst){
+        cache->offset = zone->dst_offset;
+        cache->abbr = zone->dst_abbr;
+    }
+}
+
+static inline int32_t tz_offset(tz_cache_t *cache, uint32_t utc){
+    const tz_zone_t *zone = l_zone;
+    if(cache->zone != zone || utc < cache->from || utc >= cache->until){
+        tz_cache_fill(cache, zone, utc);
+    }
+    return cache->offset;
+}
+
+// converts utc seconds to local wall clock seconds, abbr may be NULL
+uint32_t tz_to_local(tz_cache_t *cache, uint32_t utc, const char **abbr){
+    uint32_t local = utc + tz_offset(cache, utc);
+    if(abbr != NULL){
+        *abbr = cache->abbr;
+    }
+    return local;
+}
+
+// converts local wall clock seconds to utc
+// a time skipped by the start of dst is moved forward by the dst shift,
+// a time repeated by the end of dst resolves to the second, standard time occurrence
+uint32_t tz_to_utc(tz_cache_t *cache, uint32_t local){
+    const tz_zone_t *zone = l_zone;
+    int32_t offset = tz_offset(cache, local - zone->std_offset);
+    uint32_t utc = local - offset;
+    int32_t check = tz_offset(cache, utc);
+    return (check == offset)? utc: local - check;
+}
@@ -0,0 +1,62 @@
+#ifndef TZ_RULES_H
+#define TZ_RULES_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// the lcd has room for 3 characters of zone abbreviation
+#define TZ_ABBR_LEN 3
+
+// zones in the rule table, selectable with tz_select
+#define TZ_ZONE_UTC 0
+#define TZ_ZONE_LONDON 1
+#define TZ_ZONE_EASTERN 2
+#define TZ_ZONE_CENTRAL 3
+#define TZ_ZONE_MOUNTAIN 4
+#define TZ_ZONE_ARIZONA 5
+#define TZ_ZONE_PACIFIC 6
+#define TZ_ZONE_HAWAII 7
+#define TZ_ZONE_COUNT 8
+
+#define TZ_DEFAULT_ZONE TZ_ZONE_PACIFIC
+
+// POSIX "Mm.w.d/time" rule: weekday d (0 is sunday) of week w (5 is the last one) of month m,
+// at time seconds of local wall clock time
+typedef struct tz_rule_t{
+    uint8_t month;
+    uint8_t week;
+    uint8_t weekday;
+    int32_t time;
+}tz_rule_t;
+
+// one zone, written out from its POSIX TZ string
+typedef struct tz_zone_t{
+    const char *posix;
+    char std_abbr[TZ_ABBR_LEN + 1];
+    char dst_abbr[TZ_ABBR_LEN + 1];
+    int32_t std_offset;
+    int32_t dst_offset;
+    bool has_dst;
+    tz_rule_t dst_start;
+    tz_rule_t dst_end;
+}tz_zone_t;
+
+// the offset in effect for utc in [from, until), refreshed only when a time falls outside of it,
+// so a conversion is normally one compare and one add
+// every task that converts times keeps its own cache, so no locking is needed
+typedef struct tz_cache_t{
+    const tz_zone_t *zone;
+    uint32_t from;
+    uint32_t until;
+    int32_t offset;
+    const char *abbr;
+}tz_cache_t;
+
+void tz_select(uint8_t zone);
+uint8_t tz_selected(void);
+const tz_zone_t *tz_zone(uint8_t zone);
+void tz_cache_init(tz_cache_t *cache);
+uint32_t tz_to_local(tz_cache_t *cache, uint32_t utc, const char **abbr);
+uint32_t tz_to_utc(tz_cache_t *cache, uint32_t local);
+
+#endif